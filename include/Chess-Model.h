@@ -3,6 +3,7 @@
 
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <stack>
@@ -19,16 +20,69 @@ const int PROMOTION_BLOCK_Y_TOP_LEFT_WHITE = 4;       // Rank number of the top
 const int PROMOTION_BLOCK_Y_TOP_LEFT_BLACK = 3;       // Rank number of the top left corner of the promotion block
                                                       // for black pieces
 const int PROMOTION_BLOCK_WIDTH_TILE = 4;             // The width of the promotion block in terms of tiles.
-const int PAWN_DEFENDER_SCORE = 20;                   // Score of a pawn defender in king_safety_evaluation
+const int PAWN_DEFENDER_SCORE = 20;                   // Score of a pawn of the pawn shield right in front of the king in king_safety_evaluation.
+                                                      // Pawns one rank further count half of it
+const int KING_SEMI_OPEN_FILE_PENALTY = 15;           // Penalty for each file on or next to the king without a pawn of the king's color
+const int KING_OPEN_FILE_PENALTY = 30;                // Penalty for each file on or next to the king without any pawn
+const int KING_ATTACK_MAX_PENALTY = 500;              // Bound on the penalty for the enemy pieces attacking the king zone
+const int THREAT_BY_PAWN_BONUS = 60;                  // Bonus for each enemy piece other than a pawn attacked by a pawn in threat_evaluation
+const int THREAT_BY_LESSER_PIECE_BONUS = 40;          // Bonus for each enemy rook or queen attacked by a less valuable piece in threat_evaluation
+const int HANGING_PIECE_BONUS = 30;                   // Bonus for each enemy piece attacked and not defended in threat_evaluation
+const int BISHOP_PAIR_BONUS_MIDDLEGAME = 30;          // Middlegame bonus for having two bishops or more
+const int BISHOP_PAIR_BONUS_ENDGAME = 50;             // Endgame bonus for having two bishops or more
+const int KNIGHT_PAWN_ADJUSTMENT = 6;                 // Knights gain this much for each pawn of their color above 5, and lose it for each pawn below
+const int ROOK_PAWN_ADJUSTMENT = 12;                  // Rooks lose this much for each pawn of their color above 5, and gain it for each pawn below
+const int MOPUP_EDGE_BONUS = 10;                      // Bonus for each step the lone king is away from the center in a won endgame
+const int MOPUP_PROXIMITY_BONUS = 4;                  // Bonus for each step the kings are closer to each other in a won endgame
+const int KBNK_CORNER_BONUS = 20;                     // Bonus for each step the lone king is closer to a corner of the bishop's color
+const int KPK_UNSTOPPABLE_BONUS = 600;                // Bonus for a pawn the lone king cannot catch before it promotes
+const int KPK_DRAWISH_SCALE = 8;                      // The evaluation is divided by this when the lone king blocks the pawn
+const int MATERIAL_HASH_TABLE_SIZE = 1024;            // Number of entries of the material hash table. It must be a power of 2
 const int DOUBLE_PAWN_PENALTY = 15;                   // Penalty for each double pawn in pawn structure evaluation
 const int ISOLATED_PAWN_PENALTY = 25;                 // Penalty for each isolated pawn in pawn structure evaluation
+const int BACKWARD_PAWN_PENALTY = 10;                 // Penalty for each backward pawn in pawn structure evaluation
+const int CONNECTED_PAWN_BONUS = 10;                  // Bonus for each pawn defended by or standing next to another pawn of its color
+const int PASSED_PAWN_BONUS_MIDDLEGAME[8] = {0,5,10,15,25,40,60,0};  // Middlegame bonus of a passed pawn by number of ranks advanced
+const int PASSED_PAWN_BONUS_ENDGAME[8] = {0,10,20,35,60,90,130,0};   // Endgame bonus of a passed pawn by number of ranks advanced
+const int PAWN_HASH_TABLE_SIZE = 8192;                // Number of entries of the pawn hash table. It must be a power of 2
+const int EVALUATION_CACHE_SIZE = 32768;              // Number of entries of the evaluation cache. It must be a power of 2
 const int TYPE_OF_PIECE_COUNT = 6;                    // Number of different types of pieces on Chess board
-const int PIECE_VALUE[TYPE_OF_PIECE_COUNT] = {100,320,330,500,900,20000}; // Piece values for PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
+constexpr int PIECE_VALUE[TYPE_OF_PIECE_COUNT] = {100,320,330,500,900,20000}; // Piece values for PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
 const int PIECE_PHASE_WEIGHT[TYPE_OF_PIECE_COUNT] = {0,1,1,2,4,0};        // How much each piece contributes to the game phase
-const int OPENING_PIECES_COUNT[TYPE_OF_PIECE_COUNT] = {16,4,4,4,2,2};      // Number of each piece type at the start of the game
 const int PIECE_MOBILITY_VALUE[TYPE_OF_PIECE_COUNT] = {0,4,3,2,1,0};      // Mobility values of each piece type
 const int CENTER_CONTROL_BONUS[TYPE_OF_PIECE_COUNT] = {10,20,20,5,30,0};  // Center control bonus score for each piece type
+const int KING_ATTACK_WEIGHT[TYPE_OF_PIECE_COUNT] = {0,2,2,3,5,0};        // Attack units for each king zone tile attacked by each piece type
 const int MINIMAX_DEPTH = 4;
+const int CHECKMATE_SCORE = 100000;                   // Score of a checkmate. The ply at which the mate happens is taken off it
+const int CHECK_EXTENSION_PLY_LIMIT = 2 * MINIMAX_DEPTH; // Checks are no longer extended once the search is this many plies deep
+const int MAX_SEARCH_PLY = 64;                        // Hard limit on how many plies deep the search can go
+const int IID_DEPTH_THRESHOLD = 3;                    // Minimum depth at which internal iterative deepening is used
+const int IID_DEPTH_REDUCTION = 2;                    // Depth reduction of the internal iterative deepening search
+const int SINGULAR_EXTENSION_DEPTH = 3;               // Minimum depth at which a move can be extended for being singular
+const int SINGULAR_EXTENSION_MARGIN = 50;             // How much worse than the best move every other move must be for it to be singular
+const int PROBCUT_DEPTH = 3;                          // Minimum depth at which ProbCut is tried
+const int PROBCUT_DEPTH_REDUCTION = 2;                // Depth reduction of the shallow ProbCut search
+const int PROBCUT_MARGIN = 200;                       // How far beyond beta (or alpha) the shallow ProbCut search must land to cut
+const int DRAW_SCORE = 0;                             // Score of a drawn position
+const int FIFTY_MOVE_RULE_PLIES = 100;                // Number of plies without a capture or pawn move after which the game is drawn
+const int MATERIAL_SIGNATURE_BITS = 4;                // Number of bits used to count each piece type of each color in the material signature
+const int NO_SEARCH_PLY = -1;                         // Used when moves are generated outside of the search
+const int HISTORY_MAX = 16384;                        // Bound on the continuation history scores
+const int COUNTERMOVE_BONUS = 2 * HISTORY_MAX;        // Ordering bonus of the countermove, putting it ahead of all other quiet moves
+const int LAZY_EVALUATION_MARGIN = 300;               // Bound on how much the weighted positional terms can change the piece square score
+const int EVALUATION_PROFILE_SAMPLE_RATE = 64;        // One evaluation in this many is timed, and has the cost of its steps sampled in trace mode. Power of 2
+const int MAX_PHASE_WEIGHT = 24;                      // Phase weight of the starting position (4 minor pieces, 4 rooks and 2 queens).
+                                                      // The evaluation is fully a middlegame one at this weight and fully an endgame one at 0
+const int NNUE_PIECE_KINDS = 10;                      // Pieces other than kings seen by the neural network, of both colors
+constexpr int NNUE_INPUT_SIZE = BOARD_SIZE * BOARD_SIZE * NNUE_PIECE_KINDS * BOARD_SIZE * BOARD_SIZE; // One input for each king tile, piece kind and piece tile
+const int NNUE_HIDDEN_SIZE = 256;                     // Number of neurons of the accumulator of each perspective
+const int NNUE_LAYER_SIZE = 32;                       // Number of neurons of each of the 2 small hidden layers
+const int NNUE_ACTIVATION_MAX = 127;                  // Upper bound of the clipped ReLU activation of the network
+const int NNUE_WEIGHT_SCALE_BITS = 6;                 // The outputs of the small hidden layers are divided by 2^NNUE_WEIGHT_SCALE_BITS
+const int NNUE_OUTPUT_SCALE = 16;                     // The output of the network is divided by this to get centipawns
+const uint32_t NNUE_FILE_MAGIC = 0x45554E4E;          // First 4 bytes of a network file, which read "NNUE"
+const uint32_t NNUE_FILE_VERSION = 1;                 // Version of the network file format
+const int EMPTY_PIECE_CODE = 0;                       // Piece code of an empty tile, see piece_code
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,7 +92,7 @@ const int MINIMAX_DEPTH = 4;
 /* PAWN */
 
 // Piece square table for pawn for opening game
-const int pawn_piece_table_opening[8][8] = {
+constexpr int pawn_piece_table_opening[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0},
     {5, 10, 10, -20, -20, 10, 10, 5},
     {5, -5, -10, 0, 0, -10, -5, 5},
@@ -49,18 +103,6 @@ const int pawn_piece_table_opening[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0}
 };
 
-// Piece square table for pawn for middle game
-const int pawn_piece_table_middlegame[8][8] = {
-    {0, 0, 0, 0, 0, 0, 0, 0},
-    {5, 10, 10, -10, -10, 10, 10, 5},
-    {5, -5, -10, 0, 0, -10, -5, 5},
-    {0, 0, 0, 20, 20, 0, 0, 0},
-    {5, 5, 10, 25, 25, 10, 5, 5},
-    {10, 10, 20, 30, 30, 20, 10, 10},
-    {40, 40, 40, 45, 45, 40, 40, 40},
-    {0, 0, 0, 0, 0, 0, 0, 0}
-};
-
 // Piece square table for pawn for endgame
 // const int pawn_piece_table_endgame[8][8] = {
 //     {0, 0, 0, 0, 0, 0, 0, 0},
@@ -73,7 +115,7 @@ const int pawn_piece_table_middlegame[8][8] = {
 //     {0, 0, 0, 0, 0, 0, 0, 0}
 // };
 
-const int pawn_piece_table_endgame[8][8] = {
+constexpr int pawn_piece_table_endgame[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0},
     {80, 90, 100, 110, 110, 100, 90, 80},
     {60, 70, 80, 90, 90, 80, 70, 60},
@@ -88,7 +130,7 @@ const int pawn_piece_table_endgame[8][8] = {
 /* KNIGHT */
 
 // Piece square table for knight for opening
-const int knight_piece_table_opening[8][8] = {
+constexpr int knight_piece_table_opening[8][8] = {
     {-50, -40, -30, -30, -30, -30, -40, -50},
     {-40, -20, 0, 0, 0, 0, -20, -40},
     {-30, 0, 10, 15, 15, 10, 0, -30},
@@ -99,20 +141,8 @@ const int knight_piece_table_opening[8][8] = {
     {-50, -40, -30, -30, -30, -30, -40, -50}
 };
 
-// Piece square table for Knight for middle game
-const int knight_piece_table_middlegame[8][8] = {
-    {-50, -30, -20, -20, -20, -20, -30, -50},
-    {-30, -10, 0, 0, 0, 0, -10, -30},
-    {-20, 0, 10, 15, 15, 10, 0, -20},
-    {-20, 5, 15, 20, 20, 15, 5, -20},
-    {-20, 0, 15, 20, 20, 15, 0, -20},
-    {-20, 5, 10, 15, 15, 10, 5, -20},
-    {-30, -10, 0, 5, 5, 0, -10, -30},
-    {-50, -30, -20, -20, -20, -20, -30, -50}
-};
-
 // Piece square table for Knight for endgame
-const int knight_piece_table_endgame[8][8] = {
+constexpr int knight_piece_table_endgame[8][8] = {
     {-50, -30, -20, -10, -10, -20, -30, -50},
     {-30, -10, 0, 0, 0, 0, -10, -30},
     {-20, 0, 10, 15, 15, 10, 0, -20},
@@ -138,7 +168,7 @@ const int knight_piece_table_endgame[8][8] = {
 /* BISHOP */
 
 // Piece square table for bishop for opening
-const int bishop_piece_table_opening[8][8] = {
+constexpr int bishop_piece_table_opening[8][8] = {
     {-20, -10, -10, -10, -10, -10, -10, -20},
     {-10, 0, 0, 0, 0, 0, 0, -10},
     {-10, 0, 5, 10, 10, 5, 0, -10},
@@ -149,20 +179,8 @@ const int bishop_piece_table_opening[8][8] = {
     {-20, -10, -10, -10, -10, -10, -10, -20}
 };
 
-// Piece square table for bishop for middle game
-const int bishop_piece_table_middlegame[8][8] = {
-    {-20, -10, -10, -10, -10, -10, -10, -20},
-    {-10, 0, 0, 0, 0, 0, 0, -10},
-    {-10, 0, 5, 10, 10, 5, 0, -10},
-    {-10, 5, 5, 10, 10, 5, 5, -10},
-    {-10, 0, 10, 10, 10, 10, 0, -10},
-    {-10, 10, 10, 10, 10, 10, 10, -10},
-    {-10, 0, 0, 0, 0, 0, 0, -10},
-    {-20, -10, -10, -10, -10, -10, -10, -20}
-};
-
 // Piece square table for bishop for endgame
-const int bishop_piece_table_endgame[8][8] = {
+constexpr int bishop_piece_table_endgame[8][8] = {
     {-10, -10, -10, -10, -10, -10, -10, -10},
     {-10, 0, 0, 0, 0, 0, 0, -10},
     {-10, 0, 10, 10, 10, 10, 0, -10},
@@ -188,7 +206,7 @@ const int bishop_piece_table_endgame[8][8] = {
 /* ROOK */
 
 // Piece square table for rook for opening
-const int rook_piece_table_opening[8][8] = {
+constexpr int rook_piece_table_opening[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0},
     {5, 10, 10, 10, 10, 10, 10, 5},
     {-5, 0, 0, 0, 0, 0, 0, -5},
@@ -199,21 +217,8 @@ const int rook_piece_table_opening[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0}
 };
 
-// Piece square table for rook for middlegame
-const int rook_piece_table_middlegame[8][8] = {
-    {0, 0, 0, 5, 5, 0, 0, 0},
-    {5, 10, 10, 10, 10, 10, 10, 5},
-    {-5, 0, 0, 0, 0, 0, 0, -5},
-    {-5, 0, 0, 0, 0, 0, 0, -5},
-    {-5, 0, 0, 0, 0, 0, 0, -5},
-    {-5, 0, 0, 0, 0, 0, 0, -5},
-    {0, 0, 0, 5, 5, 0, 0, 0},
-    {0, 0, 0, 0, 0, 0, 0, 0}
-};
-
-
 // Piece square table for rook for endgame
-const int rook_piece_table_endgame[8][8] = {
+constexpr int rook_piece_table_endgame[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0},
     {0, 5, 10, 10, 10, 10, 5, 0},
     {-5, 0, 0, 5, 5, 0, 0, -5},
@@ -239,7 +244,7 @@ const int rook_piece_table_endgame[8][8] = {
 /* QUEEN */
 
 // For the queen, only 1 piece square table is needed
-const int queen_piece_table[8][8] = {
+constexpr int queen_piece_table[8][8] = {
     {-20, -10, -10, -5, -5, -10, -10, -20},
     {-10, 0, 0, 0, 0, 0, 0, -10},
     {-10, 0, 5, 5, 5, 5, 0, -10},
@@ -265,19 +270,7 @@ const int queen_piece_table[8][8] = {
 /* KING */
 
 // Piece square table for king for opening
-const int king_piece_table_opening[8][8] = {
-    {20, 30, 10, 0, 0, 10, 30, 20},
-    {20, 20, 0, 0, 0, 0, 20, 20},
-    {-10, -20, -20, -20, -20, -20, -20, -10},
-    {-20, -30, -30, -40, -40, -30, -30, -20},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30}
-};
-
-// Piece square table for king for middlegame
-const int king_piece_table_middlegame[8][8] = {
+constexpr int king_piece_table_opening[8][8] = {
     {20, 30, 10, 0, 0, 10, 30, 20},
     {20, 20, 0, 0, 0, 0, 20, 20},
     {-10, -20, -20, -20, -20, -20, -20, -10},
@@ -289,7 +282,7 @@ const int king_piece_table_middlegame[8][8] = {
 };
 
 // Piece square table for king for endgame
-const int king_piece_table_endgame[8][8] = {
+constexpr int king_piece_table_endgame[8][8] = {
     {-50, -40, -30, -20, -20, -30, -40, -50},
     {-30, -20, -10, 0, 0, -10, -20, -30},
     {-30, -10, 20, 30, 30, 20, -10, -30},
@@ -315,36 +308,95 @@ const int king_piece_table_endgame[8][8] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief the enum represents the weight of each heuristic in the evaluation, as fixed-point numbers with a scale of
+ * EVALUATION_WEIGHT_SCALE (a percentage). The evaluation only uses integer arithmetic.
+ */
 enum heuristic_weights_percentage
 {
+    EVALUATION_WEIGHT_SCALE = 100,
     MATERIAL_EVALUATION_WEIGHT_PERCENTAGE = 110,
     POSITIONAL_EVALUATION_WEIGHT_PERCENTAGE = 15,
     MOBILITY_EVALUATION_WEIGHT_PERCENTAGE = 10,
     KING_SAFETY_EVALUATION_WEIGHT_PERCENTAGE = 20,
     PAWN_STRUCTURE_EVALUATION_WEIGHT_PERCENTAGE = 15,
-    CENTER_CONTROL_EVALUATION_WEIGHT_PERCENTAGE = 10
+    CENTER_CONTROL_EVALUATION_WEIGHT_PERCENTAGE = 10,
+    THREAT_EVALUATION_WEIGHT_PERCENTAGE = 10
+};
+
+/**
+ * @brief Enum used to name the evaluation parameters holding a single number. Their default values are the
+ * constants of the same name.
+ */
+enum scalar_parameter
+{
+    MATERIAL_WEIGHT_PARAMETER,        // MATERIAL_EVALUATION_WEIGHT_PERCENTAGE
+    POSITIONAL_WEIGHT_PARAMETER,      // POSITIONAL_EVALUATION_WEIGHT_PERCENTAGE
+    MOBILITY_WEIGHT_PARAMETER,        // MOBILITY_EVALUATION_WEIGHT_PERCENTAGE
+    KING_SAFETY_WEIGHT_PARAMETER,     // KING_SAFETY_EVALUATION_WEIGHT_PERCENTAGE
+    PAWN_STRUCTURE_WEIGHT_PARAMETER,  // PAWN_STRUCTURE_EVALUATION_WEIGHT_PERCENTAGE
+    CENTER_CONTROL_WEIGHT_PARAMETER,  // CENTER_CONTROL_EVALUATION_WEIGHT_PERCENTAGE
+    THREAT_WEIGHT_PARAMETER,          // THREAT_EVALUATION_WEIGHT_PERCENTAGE
+    PAWN_DEFENDER_SCORE_PARAMETER,    // PAWN_DEFENDER_SCORE
+    DOUBLE_PAWN_PENALTY_PARAMETER,    // DOUBLE_PAWN_PENALTY
+    ISOLATED_PAWN_PENALTY_PARAMETER,  // ISOLATED_PAWN_PENALTY
+    BACKWARD_PAWN_PENALTY_PARAMETER,  // BACKWARD_PAWN_PENALTY
+    CONNECTED_PAWN_BONUS_PARAMETER,   // CONNECTED_PAWN_BONUS
+    SCALAR_PARAMETER_COUNT
+};
+
+/**
+ * @brief Enum used to name the two piece square tables of each piece type
+ */
+enum game_stage
+{
+    MIDDLEGAME_STAGE,
+    ENDGAME_STAGE,
+    GAME_STAGE_COUNT
 };
 
 /**
- * @brief Enum used to keep track of the current phase of the game
+ * @brief struct holding the evaluation parameters which can be tuned and loaded from a parameter file at startup.
+ * The default parameters are the constants and piece tables of this file.
  */
-enum game_phase
+struct evaluation_parameters
 {
-    OPENING,
-    MIDDLE_GAME,
-    ENDGAME
+    int scalars[SCALAR_PARAMETER_COUNT];                                          // Value of each scalar parameter
+    int piece_tables[TYPE_OF_PIECE_COUNT][GAME_STAGE_COUNT][BOARD_SIZE * BOARD_SIZE]; // Piece square tables from white's point of view,
+                                                                                  // tile rank * BOARD_SIZE + file
 };
 
 /**
- * @brief the enum represents the phase ratio for each game phase * 100. It is used to determine in which
- * game phase we are
+ * @brief Enum used to name the evaluation terms which can be left out of a build. Each term is a bit, so a feature
+ * set is a combination of them. The piece square score, which includes the material, is always evaluated.
  */
-enum game_phase_ratio
+enum evaluation_feature
 {
-    OPENING_PHASE_RATIO = 55,
-    MIDDLE_GAME_PHASE_RATIO = 20
+    MATERIAL_IMBALANCE_FEATURE = 1 << 0, // Bishop pair and piece values depending on the pawns left
+    KNOWN_ENDGAME_FEATURE = 1 << 1,      // Dedicated evaluations of KXK, KBNK and KPK
+    MOBILITY_FEATURE = 1 << 2,           // Tiles attacked by each player
+    KING_SAFETY_FEATURE = 1 << 3,        // Pawn shield and attacks near each king
+    PAWN_STRUCTURE_FEATURE = 1 << 4,     // Doubled, isolated, backward and connected pawns
+    CENTER_CONTROL_FEATURE = 1 << 5,     // Occupation and attacks of the center tiles
+    THREAT_FEATURE = 1 << 6              // Pieces attacked by cheaper pieces or left undefended
 };
 
+// Material and piece square tables only, for fast games
+constexpr int FAST_EVALUATION_FEATURES = 0;
+// Terms skipped by the lazy evaluation when the piece square score is far outside the window
+constexpr int POSITIONAL_EVALUATION_FEATURES = MOBILITY_FEATURE | KING_SAFETY_FEATURE | PAWN_STRUCTURE_FEATURE |
+                                               CENTER_CONTROL_FEATURE | THREAT_FEATURE;
+// Every evaluation term, for analysis
+constexpr int FULL_EVALUATION_FEATURES = MATERIAL_IMBALANCE_FEATURE | KNOWN_ENDGAME_FEATURE | POSITIONAL_EVALUATION_FEATURES;
+
+// Feature set the search is built with. The CHESS_FAST_EVALUATION macro is defined by the CMake option of the same
+// name
+#ifdef CHESS_FAST_EVALUATION
+constexpr int ENGINE_EVALUATION_FEATURES = FAST_EVALUATION_FEATURES;
+#else
+constexpr int ENGINE_EVALUATION_FEATURES = FULL_EVALUATION_FEATURES;
+#endif
+
 /**
  * @brief enum used to represent the type of the chess piece
  */
@@ -400,6 +452,8 @@ struct square
 {
     int rank; // Represents a row on the chess board (1-8)
     int file; // Represents a column on the chess board(1-8)
+
+    bool operator==(const square &) const = default; // Two squares are equal if they have the same rank and file
 };
 
 /**
@@ -409,6 +463,167 @@ struct move
 {
     square from; // The tile from which the piece is moved
     square to;   // The tile to which the piece is moved
+
+    bool operator==(const move &) const = default; // Two moves are equal if they have the same start and destination squares
+};
+
+/**
+ * @brief struct holding the evaluation of a pawn structure. Pawn structures rarely change from one node of the search
+ * to the next, so entries are cached in a pawn hash table and found again from the pawn key of the board.
+ */
+struct pawn_hash_entry
+{
+    uint64_t pawn_key = 0;        // Pawn key of the pawn structure evaluated in this entry
+    int score = 0;                // Packed middlegame and endgame pawn structure evaluation, from white's point of view
+    uint8_t white_pawn_files = 0; // Bit n is set if white has a pawn on file n
+    uint8_t black_pawn_files = 0; // Bit n is set if black has a pawn on file n
+};
+
+/**
+ * @brief Enum used to name the endgames which have their own evaluation function
+ */
+enum endgame_type
+{
+    GENERIC_ENDGAME, // Evaluated by the usual heuristics
+    KXK_ENDGAME,     // A lone king against a king with a queen or a rook, or enough pieces to checkmate
+    KBNK_ENDGAME,    // A lone king against a king, a bishop and a knight
+    KPK_ENDGAME      // A lone king against a king and a pawn
+};
+
+/**
+ * @brief struct holding what is known about a material configuration, which is the number of pieces of each type and
+ * color. Configurations are few and change rarely during the search, so entries are cached in a material hash table
+ * and found again from the material signature of the board.
+ */
+struct material_hash_entry
+{
+    uint64_t material_signature = 0;       // Material signature of the configuration of this entry
+    int imbalance = 0;                     // Packed middlegame and endgame material imbalance, from white's point of view
+    endgame_type endgame = GENERIC_ENDGAME; // Endgame which has its own evaluation function, if any
+    piece_color strong_side = WHITE;       // Color playing for the win in that endgame
+};
+
+/**
+ * @brief struct holding the evaluation of a position, cached so that positions met again in other lines of the search
+ * or in the next search are not evaluated again. Only positions in which the player to move has a legal move are
+ * cached, and only when the evaluation is exact (not cut short by the lazy evaluation).
+ */
+struct evaluation_cache_entry
+{
+    uint64_t position_key = 0; // Position key of the evaluated position
+    int16_t score = 0;         // Evaluation of the position
+};
+
+/**
+ * @brief Enum used to name the terms of the handcrafted evaluation in an evaluation trace
+ */
+enum evaluation_term
+{
+    MATERIAL_TERM,       // Weighted value of the pieces
+    POSITIONAL_TERM,     // Weighted piece square tables
+    IMBALANCE_TERM,      // Material imbalance, see material_imbalance_score
+    MOBILITY_TERM,       // Weighted mobility
+    KING_SAFETY_TERM,    // Weighted king safety
+    PAWN_STRUCTURE_TERM, // Weighted pawn structure
+    CENTER_CONTROL_TERM, // Weighted center control
+    THREAT_TERM,         // Weighted threats
+    EVALUATION_TERM_COUNT
+};
+
+/**
+ * @brief struct holding the value of each evaluation term for each player, used to see which term drives the
+ * evaluation of a position. The values are in centipawns, positive when the term is good for that player. The weighted
+ * terms are rounded one by one, so their sum can differ slightly from the evaluation.
+ */
+struct evaluation_trace
+{
+    int values[EVALUATION_TERM_COUNT][LAST_COLOR] = {}; // Value of each term for each color
+    endgame_type endgame = GENERIC_ENDGAME;           // Known endgame whose own evaluation replaces the terms, if any
+    int evaluation = 0;                               // Evaluation of the position, from white's point of view
+};
+
+/**
+ * @brief Enum used to name the steps of the handcrafted evaluation whose cost is sampled when the evaluation is traced
+ */
+enum evaluation_cost
+{
+    EVALUATION_CACHE_COST,  // Evaluation cache probe
+    LEGAL_MOVE_COST,        // Search for a legal move, to detect checkmates and stalemates
+    PIECE_SQUARE_COST,      // Material and piece square tables
+    MATERIAL_HASH_COST,     // Material hash probe, material imbalance and known endgames
+    ATTACK_INFO_COST,       // Attacked tiles shared by the positional terms
+    MOBILITY_COST,          // Mobility
+    KING_SAFETY_COST,       // King safety
+    PAWN_STRUCTURE_COST,    // Pawn hash probe and pawn structure
+    CENTER_CONTROL_COST,    // Center control
+    THREAT_COST,            // Threats
+    EVALUATION_COST_COUNT
+};
+
+/**
+ * @brief struct holding counters about the search, used to see how well the search and the evaluation perform.
+ * Each thread has its own statistics, which find_best_move resets and logs.
+ */
+struct search_statistics
+{
+    uint64_t nodes = 0;                   // Number of positions searched by minimax
+    uint64_t evaluations = 0;             // Number of positions evaluated which are neither checkmate nor stalemate
+    uint64_t lazy_evaluations = 0;        // Evaluations cut short by the lazy evaluation margin
+    uint64_t evaluation_cache_probes = 0; // Number of times the evaluation cache was looked up
+    uint64_t evaluation_cache_hits = 0;   // Number of times the position was found in the evaluation cache
+    uint64_t evaluation_cache_hit_nanoseconds = 0;  // Time spent in evaluate_board on the sampled cache hits
+    uint64_t evaluation_cache_miss_nanoseconds = 0; // Time spent in evaluate_board on the sampled cache misses which computed the evaluation
+    uint64_t evaluation_cache_hits_timed = 0;       // Number of sampled cache hits
+    uint64_t evaluation_cache_misses_timed = 0;     // Number of sampled cache misses which computed the evaluation
+    uint64_t profiled_evaluations = 0;              // Number of evaluations whose cost was sampled, see set_evaluation_tracing
+    uint64_t evaluation_cycles[EVALUATION_COST_COUNT] = {}; // Processor cycles spent in each step of the sampled evaluations
+};
+
+/**
+ * @brief struct holding the tiles attacked by each type of piece of each color. It is computed once each time a
+ * position is evaluated and shared by all the evaluation terms which need to know which tiles are covered.
+ * Bit rank * BOARD_SIZE + file of a bitboard stands for the tile at that rank and file.
+ */
+struct attack_info
+{
+    uint64_t occupied = 0;                                        // Tiles occupied by any piece
+    uint64_t attacked_by_type[LAST_COLOR][TYPE_OF_PIECE_COUNT] = {}; // Tiles attacked by the pieces of each type and color
+    uint64_t attacked_by[LAST_COLOR] = {};                        // Tiles attacked by any piece of each color
+    int mobility[LAST_COLOR] = {};                                // Mobility of each color, see compute_attack_info
+    int king_attackers_count[LAST_COLOR] = {};                    // Number of pieces of each color attacking the enemy king zone
+    int king_attack_units[LAST_COLOR] = {};                       // Attack units of each color on the enemy king zone, see KING_ATTACK_WEIGHT
+};
+
+/**
+ * @brief Enum used to choose the function which evaluates the leaves of the search
+ */
+enum evaluator_type
+{
+    CLASSIC_EVALUATOR, // The handcrafted evaluation terms
+    NNUE_EVALUATOR     // The efficiently updatable neural network
+};
+
+/**
+ * @brief Enum used to name the instruction sets the neural network kernels are written for, from the slowest to
+ * the fastest
+ */
+enum nnue_instruction_set
+{
+    NNUE_SCALAR, // Portable C++, used when no faster instruction set is available
+    NNUE_SSE41,  // 128 bit x86-64 vectors
+    NNUE_AVX2    // 256 bit x86-64 vectors
+};
+
+/**
+ * @brief struct holding the first layer of the neural network for both perspectives. The first layer is the sum of
+ * the weights of every active input, so it is updated each time a piece is placed or removed instead of being
+ * computed again at each leaf of the search. An input is a piece other than a king on a tile, seen from the king of
+ * the perspective, so a perspective must be computed again from scratch when its king moves.
+ */
+struct nnue_accumulator
+{
+    alignas(32) int16_t values[LAST_COLOR][NNUE_HIDDEN_SIZE]; // Sum of the weights of the active inputs of each perspective
+    bool computed[LAST_COLOR] = {};                         // False if the perspective must be computed from scratch
 };
 
 /**
@@ -434,6 +649,10 @@ struct move_history_data
     bool prev_white_rook_h_moved; // Has the h file white rook moved since the start of the game for that move
     bool prev_black_rook_a_moved; // Has the a file black rook moved since the start of the game for that move
     bool prev_black_rook_h_moved; // Has the h file black rook moved since the start of the game for that move
+
+    uint64_t prev_position_key; // The position key before the move was made
+    int prev_halfmove_clock;    // The halfmove clock before the move was made
+    square prev_en_passant_target; // The en passant target before the move was made
 };
 
 /**
@@ -454,6 +673,80 @@ private:
     bool black_rook_a_moved = false; // Flag used to keeo track if the black rook on the a file moved since the beginning of the game
     bool black_rook_h_moved = false; // Flag used to keeo track if the black rook on the h file moved since the beginning of the game
 
+    piece_color side_to_move = WHITE; // The color of the player whose turn it is to play
+    int halfmove_clock = 0;           // Number of plies played since the last capture or pawn move
+    uint64_t position_key = 0;        // Zobrist key of the position, updated each time the board changes
+    uint64_t pawn_key = 0;            // Zobrist key of the pawns only, used by the pawn hash table
+    uint64_t piece_bitboards[LAST_COLOR][TYPE_OF_PIECE_COUNT] = {}; // Bit rank * BOARD_SIZE + file is set if the piece is on that tile
+    uint64_t color_bitboards[LAST_COLOR] = {}; // Tiles occupied by the pieces of each color
+    vector<uint64_t> position_key_history; // Position keys before each move played, used to detect repetitions
+    uint64_t material_signature = 0;  // Number of pieces of each type and color on the board, packed MATERIAL_SIGNATURE_BITS bits each
+    int piece_square_score = 0;       // Packed middlegame and endgame score of white minus black, material included
+    int phase_weight = 0;             // Sum of the PIECE_PHASE_WEIGHT of every piece on the board
+    nnue_accumulator accumulator;     // First layer of the neural network, only kept up to date while it is the evaluator
+
+    /**
+     * @brief This function computes the Zobrist key of the position from scratch
+     *
+     * @return the position key
+     */
+    uint64_t compute_position_key() const;
+
+    /**
+     * @brief This function computes the pawn key of the position from scratch
+     *
+     * @return the pawn key
+     */
+    uint64_t compute_pawn_key() const;
+
+    /**
+     * @brief This function computes the material signature of the position from scratch
+     *
+     * @return the material signature
+     */
+    uint64_t compute_material_signature() const;
+
+    /**
+     * @brief This procedure adds or removes the contribution of a piece on a tile to the piece square score and the
+     * phase weight of the board
+     *
+     * @param piece is the piece placed on or removed from the tile
+     * @param tile is the tile of the piece
+     * @param sign is 1 if the piece is placed on the tile and -1 if it is removed from it
+     */
+    void update_evaluation_terms(const chess_piece &piece, const square &tile, const int sign);
+
+    /**
+     * @brief This procedure places a piece on a tile of the bitboards if it is not there, or removes it otherwise
+     *
+     * @param piece is the piece
+     * @param tile is the tile of the piece
+     */
+    void toggle_piece_bitboards(const chess_piece &piece, const square &tile);
+
+    /**
+     * @brief This procedure adds or removes the input of a piece on a tile to the accumulators of the neural network
+     * which are computed. If the piece is a king, the accumulator of its perspective must be computed from scratch.
+     *
+     * @param piece is the piece placed on or removed from the tile
+     * @param tile is the tile of the piece
+     * @param placed is true if the piece is placed on the tile and false if it is removed from it
+     */
+    void update_accumulator(const chess_piece &piece, const square &tile, const bool placed);
+
+    /**
+     * @brief This function packs the flags used to keep track of castling rights into a number between 0 and 63
+     *
+     * @return the packed castling flags
+     */
+    int castling_flags() const;
+
+    /**
+     * @brief This procedure computes from scratch everything the board keeps up to date as pieces are placed or
+     * removed: the keys, the material signature, the piece square score, the phase weight and the bitboards
+     */
+    void initialize_incremental_state();
+
 public:
     vector<piece_type> white_pieces_remaining; // Used to keep track of all the white pieces remaining on the board
     vector<piece_type> black_pieces_remaining; // Used to keep track of all the black pieces remaining on the board
@@ -551,6 +844,136 @@ public:
      */
     bool king_in_check(piece_color king_color) const;
 
+    /**
+     * @brief This function returns the color of the player whose turn it is to play
+     *
+     * @return the color of the player to move
+     */
+    piece_color get_side_to_move() const;
+
+    /**
+     * @brief This function returns the number of plies played since the last capture or pawn move. When it reaches
+     * FIFTY_MOVE_RULE_PLIES, the game is a draw by the fifty-move rule
+     *
+     * @return the halfmove clock
+     */
+    int get_halfmove_clock() const;
+
+    /**
+     * @brief This function returns the Zobrist key of the position. Two boards with the same pieces on the same
+     * squares, the same player to move, castling rights and en passant target have the same key
+     *
+     * @return the position key
+     */
+    uint64_t get_position_key() const;
+
+    /**
+     * @brief This function returns the Zobrist key of the pawns on the board. Two boards with the same pawns on the
+     * same squares have the same pawn key, whatever the other pieces are.
+     *
+     * @return the pawn key
+     */
+    uint64_t get_pawn_key() const;
+
+    /**
+     * @brief This function returns the tiles on which pieces of a given type and color are found. Bit
+     * rank * BOARD_SIZE + file is set if such a piece is on that tile.
+     *
+     * @param color is the color of the pieces
+     * @param type is the type of the pieces
+     *
+     * @return the bitboard of the pieces
+     */
+    uint64_t get_piece_bitboard(piece_color color, piece_type type) const;
+
+    /**
+     * @brief This function returns the tiles occupied by the pieces of a color
+     *
+     * @param color is the color of the pieces
+     *
+     * @return the bitboard of the pieces of that color
+     */
+    uint64_t get_color_bitboard(piece_color color) const;
+
+    /**
+     * @brief This function returns the material signature of the position, which packs the number of pieces of each
+     * type and color on the board. It is kept up to date each time a piece is placed or removed.
+     *
+     * @return the material signature
+     */
+    uint64_t get_material_signature() const;
+
+    /**
+     * @brief This function returns the piece square score of white minus black, with the middlegame and endgame
+     * scores packed together (see make_score). The value of the pieces is included in it. It is kept up to date each
+     * time a piece is placed or removed, so it does not need to be computed at each leaf of the search.
+     *
+     * @return the packed piece square score
+     */
+    int get_piece_square_score() const;
+
+    /**
+     * @brief This function returns the sum of the PIECE_PHASE_WEIGHT of every piece on the board
+     *
+     * @return the phase weight
+     */
+    int get_phase_weight() const;
+
+    /**
+     * @brief This function returns the accumulator of the neural network, after computing from scratch the
+     * perspectives which are not computed
+     *
+     * @return the accumulator
+     */
+    const nnue_accumulator &get_accumulator();
+
+    /**
+     * @brief This procedure writes the piece code of every tile of the board, see piece_code. Tile rank * BOARD_SIZE +
+     * file is written at that index.
+     *
+     * @param piece_codes is the array of BOARD_SIZE * BOARD_SIZE piece codes to write
+     */
+    void get_piece_codes(uint8_t *piece_codes) const;
+
+    /**
+     * @brief This function sets up the board from a position in Forsyth-Edwards Notation. The move history is
+     * cleared. The move counters at the end of the notation may be left out. A negative halfmove clock, or an en
+     * passant target which is not on the 6th rank with white to move or on the 3rd rank with black to move, is not
+     * valid.
+     *
+     * @param fen is the position
+     *
+     * @return true if the position was set up and false if the notation is not valid, in which case the board is
+     * left unchanged
+     */
+    bool load_fen(const string &fen);
+
+    /**
+     * @brief This function computes from scratch everything the board keeps up to date as pieces are placed or
+     * removed, and checks that it matches the values kept up to date
+     *
+     * @return true if all the values match and false otherwise
+     */
+    bool verify_incremental_state() const;
+
+    /**
+     * @brief This function returns the number of pieces of a given type and color on the board
+     *
+     * @param color is the color of the pieces
+     * @param type is the type of the pieces
+     *
+     * @return the number of those pieces
+     */
+    int get_piece_count(piece_color color, piece_type type) const;
+
+    /**
+     * @brief This function counts how many times the current position already occurred since the last capture
+     * or pawn move. A count of 2 means the position has been repeated three times.
+     *
+     * @return the number of earlier occurrences of the current position
+     */
+    int repetition_count() const;
+
     /**
      * @brief The method checks if there is a checkmate or stalemate on the board
      *
@@ -590,6 +1013,72 @@ public:
     bool get_black_rook_h_moved() const;
 };
 
+/**
+ * @brief This function returns a number between 0 and LAST_TYPE * LAST_COLOR standing for a piece, used when the
+ * whole board is stored in a compact array
+ *
+ * @param piece is the piece
+ *
+ * @return EMPTY_PIECE_CODE if there is no piece, and 1 + type * LAST_COLOR + color otherwise
+ */
+constexpr int piece_code(const chess_piece &piece)
+{
+    return (piece.type == NONE) ? EMPTY_PIECE_CODE : 1 + (int)piece.type * LAST_COLOR + (int)piece.color;
+}
+
+/**
+ * @brief This function returns the amount added to the material signature for one piece of the given type and color
+ *
+ * @param color is the color of the piece
+ * @param type is the type of the piece
+ *
+ * @return the material signature of that single piece
+ */
+constexpr uint64_t material_signature_unit(piece_color color, piece_type type)
+{
+    return 1ULL << ((color * TYPE_OF_PIECE_COUNT + type) * MATERIAL_SIGNATURE_BITS);
+}
+
+/**
+ * @brief This function packs a middlegame and an endgame score into a single int, the endgame score in the upper
+ * 16 bits and the middlegame score in the lower 16 bits. Packed scores can be added, substracted and multiplied by
+ * a small integer directly, which updates both scores at once.
+ *
+ * @param middlegame_score is the score in the middlegame
+ * @param endgame_score is the score in the endgame
+ *
+ * @return the packed score
+ */
+constexpr int make_score(int middlegame_score, int endgame_score)
+{
+    return (int)((unsigned int)endgame_score << 16) + middlegame_score;
+}
+
+/**
+ * @brief This function extracts the middlegame score from a packed score
+ *
+ * @param packed_score is a score made by make_score
+ *
+ * @return the middlegame score
+ */
+constexpr int middlegame_value(int packed_score)
+{
+    return (int16_t)(uint16_t)(unsigned int)packed_score;
+}
+
+/**
+ * @brief This function extracts the endgame score from a packed score. The rounding makes up for the borrow taken
+ * from the upper half when the middlegame score is negative.
+ *
+ * @param packed_score is a score made by make_score
+ *
+ * @return the endgame score
+ */
+constexpr int endgame_value(int packed_score)
+{
+    return (int16_t)(uint16_t)(((unsigned int)packed_score + 0x8000) >> 16);
+}
+
 /**
  * @brief This struct is used to store the details for a particular game
  */
@@ -696,57 +1185,122 @@ bool check_for_obstruction(const board &the_board, const move &current_move, int
 bool valid_move_simulated(board &the_board, const move current_move, bool valid_move);
 
 /**
- * @brief The function returns the evaluation based on the number of pieces each player has. White is always the
- * maximizing player while Black is always the minimizing player. Hence, a positive value means WHITE is being favoured
- * for this criteria while a negative value means that BLACK is being favoured for this criteria.
+ * @brief The function takes the board and determines how far the game is from the endgame. The phase goes
+ * continuously from MAX_PHASE_WEIGHT, when all the pieces are on the board, to 0 when only kings and pawns are left.
  *
- * @param the_board is the current state of the chess board
+ * @param the_board is the state of the board
  *
- * @return the material evaluation for the current state of the chess board
+ * @return the game phase, between 0 and MAX_PHASE_WEIGHT
  */
-int material_evaluation(const board &the_board);
+int determine_game_phase(const board &the_board);
 
 /**
- * @brief The function takes the board and analyses it. Based on the analysis, it
- * decides whether we are in the opening, the middle game or the endgame.
+ * @brief The function interpolates between the middlegame and endgame scores of a packed score according to the
+ * game phase, so that the evaluation changes smoothly as pieces come off the board
  *
- * @param the_board is the state of the board
+ * @param packed_score is a score made by make_score
+ * @param phase is the game phase, between 0 and MAX_PHASE_WEIGHT
  *
- * @return the game phase
+ * @return the tapered score
  */
-game_phase determine_game_phase(const board &the_board);
+int taper_score(int packed_score, int phase);
 
 /**
- * @brief The function returns the evaluation based on the positions of the different pieces
- * at the different stages of the game. It uses piece tables to generate the evaluation
+ * @brief The function returns the middlegame and endgame scores of a piece on a tile, packed together. The scores
+ * hold the value of the piece and its piece square table score, both already weighted. They are from white's point
+ * of view, so they are negative for black pieces. An empty tile scores 0.
  *
- * @param the_board is the state of the board
+ * @param piece is the piece
+ * @param tile is the tile of the piece
  *
- * @return the evaluation
+ * @return the packed piece square score
  */
-int positional_evaluation(const board &the_board);
+int piece_square_value(const chess_piece &piece, const square &tile);
 
 /**
- * @brief The function provides an evaluation based on how freely the white and black pieces can move
+ * @brief The function returns the evaluation based on the value of the pieces and on their positions at the
+ * different stages of the game. It uses piece tables to generate the evaluation. The packed piece square
+ * score is kept up to date by the board and is tapered between its middlegame and endgame values. White is always
+ * the maximizing player, so a positive value means WHITE is being favoured.
  *
  * @param the_board is the state of the board
  *
- * @return the evaluation
+ * @return the evaluation, weighted by MATERIAL_EVALUATION_WEIGHT_PERCENTAGE and POSITIONAL_EVALUATION_WEIGHT_PERCENTAGE
  */
-int mobility_evaluation(const board &the_board);
+int piece_square_evaluation(const board &the_board);
 
 /**
- * @brief The function returns an evaluation based on how many pawns are surrounding the king to protect it
+ * @brief The function computes the tiles attacked by each type of piece of each color, from the bitboards of the
+ * board. It also computes the mobility of each color, which is how freely its knights, bishops, rooks and queens
+ * can move: each tile a piece attacks counts PIECE_MOBILITY_VALUE of the piece, unless it holds a piece of the same
+ * color or is attacked by an enemy pawn. Checks and pins are ignored, so no moves need to be generated. Finally, it
+ * counts how many of these pieces attack the enemy king zone, and the attack units they put on it.
  *
- * @param the_board is the board state
+ * @param the_board is the state of the board
  *
- * @return the evaluation.
+ * @return the attacks of both colors
  */
-int king_safety_evaluation(const board &the_board);
+attack_info compute_attack_info(const board &the_board);
 
 /**
- * @brief The function checks the structure of the pawn by checking for double pawns or isolated pawns, then makes an evaluation
- * based on this.
+ * @brief The function provides an evaluation based on how freely the white and black pieces can move
+ *
+ * @param attacks are the attacks of both colors on the board being evaluated
+ *
+ * @return the evaluation
+ */
+int mobility_evaluation(const attack_info &attacks);
+
+/**
+ * @brief The function returns how safe the king of one color is. Pawns of the pawn shield in front of the king
+ * protect it, while files on or next to the king without pawns of its color expose it. The enemy pieces attacking the
+ * king zone are scored from their attack units, which grow quadratically so that several attackers weigh much more
+ * than one. A single attacker is not counted, as it can rarely checkmate on its own.
+ *
+ * @param the_board is the board state
+ * @param attacks are the attacks of both colors on the board
+ * @param color is the color of the king
+ *
+ * @return the packed middlegame and endgame king safety of that color, positive when the king is safe
+ */
+int king_safety_score(const board &the_board, const attack_info &attacks, piece_color color);
+
+/**
+ * @brief The function returns an evaluation based on the safety of both kings. It matters less and less as the
+ * pieces come off the board, so it is tapered according to the game phase.
+ *
+ * @param the_board is the board state
+ * @param attacks are the attacks of both colors on the board
+ *
+ * @return the evaluation.
+ */
+int king_safety_evaluation(const board &the_board, const attack_info &attacks);
+
+/**
+ * @brief The function finds the evaluation of the pawn structure of the board in the pawn hash table. If the pawn
+ * structure is not found, it is evaluated and stored in the table. Each thread has its own table.
+ *
+ * @param the_board is the board state
+ *
+ * @return the pawn hash table entry of the pawn structure
+ */
+const pawn_hash_entry &probe_pawn_hash(const board &the_board);
+
+/**
+ * @brief The function returns the evaluation of the pawns of one color. It checks for double, isolated and backward
+ * pawns, and rewards connected and passed pawns. Everything is computed on bitboards.
+ *
+ * @param own_pawns is the bitboard of the pawns being evaluated
+ * @param enemy_pawns is the bitboard of the pawns of the other color
+ * @param color is the color of the pawns being evaluated
+ *
+ * @return the packed middlegame and endgame evaluation, positive when the pawn structure is good for that color
+ */
+int pawn_structure_score(uint64_t own_pawns, uint64_t enemy_pawns, piece_color color);
+
+/**
+ * @brief The function checks the structure of the pawns of both players, then makes an evaluation based on this. The
+ * evaluation is cached in the pawn hash table and tapered according to the game phase.
  *
  * @param the_board is the board state
  *
@@ -754,24 +1308,378 @@ int king_safety_evaluation(const board &the_board);
  */
 int pawn_structure_evaluation(const board &the_board);
 
+/**
+ * @brief The function returns how much one color controls the center. Each piece standing on or attacking one of
+ * the 4 central tiles counts CENTER_CONTROL_BONUS of its type.
+ *
+ * @param the_board is the state of the board
+ * @param attacks are the attacks of both colors on the board
+ * @param color is the color of the pieces
+ *
+ * @return the center control of that color
+ */
+int center_control_score(const board &the_board, const attack_info &attacks, piece_color color);
+
 /**
  * @brief The function checks who controls the center and returns an evaluation based on that.
  *
  * @param the_board is the state of the board
+ * @param attacks are the attacks of both colors on the board
+ *
+ * @return the evaluation
+ */
+int center_control_evaluation(const board &the_board, const attack_info &attacks);
+
+/**
+ * @brief The function returns how much one color threatens the pieces of the other color. Enemy pieces attacked by a
+ * pawn, enemy rooks and queens attacked by less valuable pieces and enemy pieces left undefended are all threats.
+ *
+ * @param the_board is the state of the board
+ * @param attacks are the attacks of both colors on the board
+ * @param color is the color making the threats
+ *
+ * @return the threats of that color
+ */
+int threat_score(const board &the_board, const attack_info &attacks, piece_color color);
+
+/**
+ * @brief The function returns an evaluation based on the threats each player makes against the pieces of the other
+ *
+ * @param the_board is the state of the board
+ * @param attacks are the attacks of both colors on the board
+ *
+ * @return the evaluation
+ */
+int threat_evaluation(const board &the_board, const attack_info &attacks);
+
+/**
+ * @brief The function checks if neither player has enough material left to checkmate, which makes the game a dead
+ * draw. This is the case for king against king, a single minor piece against a lone king and bishops on squares of
+ * the same color. The material signature tells us straight away if the position can be one of those.
+ *
+ * @param the_board is the state of the board
+ *
+ * @return true if neither player can checkmate and false otherwise
+ */
+bool insufficient_material(const board &the_board);
+
+/**
+ * @brief The function finds what is known about the material configuration of the board in the material hash table.
+ * If the configuration is not found, its material imbalance and endgame type are computed and stored in the table.
+ * Each thread has its own table.
+ *
+ * @param the_board is the state of the board
+ *
+ * @return the material hash table entry of the material configuration
+ */
+const material_hash_entry &probe_material_hash(const board &the_board);
+
+/**
+ * @brief The function returns the material imbalance of one color. The value of the pieces does not only depend on
+ * their type: a pair of bishops is worth more than two bishops apart, knights are better with many pawns on the board
+ * and rooks with few.
+ *
+ * @param the_board is the state of the board
+ * @param color is the color of the pieces
+ *
+ * @return the packed middlegame and endgame material imbalance of that color
+ */
+int material_imbalance_score(const board &the_board, piece_color color);
+
+/**
+ * @brief The function returns an evaluation based on the material imbalance of both players, tapered according to
+ * the game phase
+ *
+ * @param the_board is the state of the board
  *
  * @return the evaluation
  */
-int center_control_evaluation(const board &the_board);
+int material_imbalance_evaluation(const board &the_board);
+
+/**
+ * @brief The function evaluates a lone king against a king with enough material to checkmate. To checkmate, the lone
+ * king must be pushed to the edge of the board and the other king must come close, so both are rewarded.
+ *
+ * @param the_board is the state of the board
+ * @param strong_side is the color of the player who is not left with a lone king
+ *
+ * @return the evaluation, from white's point of view
+ */
+int kxk_evaluation(const board &the_board, piece_color strong_side);
+
+/**
+ * @brief The function evaluates a lone king against a king, a bishop and a knight. Checkmate is only possible in a
+ * corner of the color of the bishop's squares, so the lone king is pushed towards one of them.
+ *
+ * @param the_board is the state of the board
+ * @param strong_side is the color of the player with the bishop and the knight
+ *
+ * @return the evaluation, from white's point of view
+ */
+int kbnk_evaluation(const board &the_board, piece_color strong_side);
+
+/**
+ * @brief The function evaluates a lone king against a king and a pawn. The pawn wins if the lone king cannot catch it
+ * before it promotes. A rook pawn with the lone king in its promotion corner is a draw, and a lone king standing in
+ * front of the pawn makes a draw likely.
+ *
+ * @param the_board is the state of the board
+ * @param strong_side is the color of the player with the pawn
+ *
+ * @return the evaluation, from white's point of view
+ */
+int kpk_evaluation(const board &the_board, piece_color strong_side);
+
+/**
+ * @brief The function returns the score of a position in which a player is checkmated
+ *
+ * @param checkmated_color is the color of the player who is checkmated
+ * @param ply is the number of moves played from the root of the search to reach this position. It is used
+ * so that the AI prefers the shortest path to checkmate
+ *
+ * @return the checkmate score
+ */
+int checkmated_score(piece_color checkmated_color, const int ply);
 
 /**
  * @brief The function takes the board state and evaluates the position to see who has
- * an advantage
+ * an advantage. If the player to move has no legal move, the position is scored as a checkmate or a stalemate.
+ * When the piece square score alone is more than LAZY_EVALUATION_MARGIN outside the alpha-beta window, the
+ * positional terms cannot bring the evaluation back into it, so they are not computed and the piece square score
+ * is returned. The handcrafted terms evaluated are those of ENGINE_EVALUATION_FEATURES.
+ *
+ * @param the_board is the state of the board
+ * @param ply is the number of moves played from the root of the search to reach this position. It is used
+ * so that the AI prefers the shortest path to checkmate
+ * @param player_color is the color of the player to move
+ * @param in_check is true if the king of the player to move is in check. The caller already knows it, so it
+ * is not computed again
+ * @param alpha is the best evaluation the maximizing player is already assured of
+ * @param beta is the best evaluation the minimizing player is already assured of
+ *
+ * @return the evaluation
+ */
+int evaluate_board(board &the_board, const int ply, piece_color player_color, const bool in_check, int alpha, int beta);
+
+/**
+ * @brief The function evaluates the position with the handcrafted terms of a feature set chosen at compile time, see
+ * evaluate_board. The terms left out of the feature set are not compiled in. The evaluation cache is only used by
+ * the feature set of the engine, ENGINE_EVALUATION_FEATURES, as it holds the evaluations of that feature set.
+ * The function is instantiated for FAST_EVALUATION_FEATURES, FULL_EVALUATION_FEATURES and
+ * ENGINE_EVALUATION_FEATURES.
  *
+ * @tparam features is the combination of evaluation_feature to evaluate
  * @param the_board is the state of the board
+ * @param ply is the number of moves played from the root of the search to reach this position
+ * @param player_color is the color of the player to move
+ * @param in_check is true if the king of the player to move is in check
+ * @param alpha is the best evaluation the maximizing player is already assured of
+ * @param beta is the best evaluation the minimizing player is already assured of
  *
  * @return the evaluation
  */
-int evaluate_board(board &the_board, const int &depth);
+template <int features>
+int evaluate_board_terms(board &the_board, const int ply, piece_color player_color, const bool in_check, int alpha, int beta);
+
+/**
+ * @brief The function returns the evaluation parameters in use
+ *
+ * @return the evaluation parameters
+ */
+const evaluation_parameters &get_evaluation_parameters();
+
+/**
+ * @brief The procedure replaces the evaluation parameters in use and clears the evaluation caches of the calling
+ * thread. The piece square score kept by a board depends on the parameters, so boards created before must be set up
+ * again, and other threads must call clear_evaluation_caches.
+ *
+ * @param parameters is the new evaluation parameters
+ */
+void set_evaluation_parameters(const evaluation_parameters &parameters);
+
+/**
+ * @brief The procedure empties the pawn hash table, the material hash table and the evaluation cache of the calling
+ * thread, which hold scores computed with the evaluation parameters
+ */
+void clear_evaluation_caches();
+
+/**
+ * @brief The function loads the evaluation parameters from a parameter file, as written by
+ * save_evaluation_parameters. Parameters missing from the file keep their current value.
+ *
+ * @param path is the path of the parameter file
+ *
+ * @return true if the parameters were loaded and false if the file cannot be read or is not valid, in which case
+ * the parameters in use are left unchanged
+ */
+bool load_evaluation_parameters(const string &path);
+
+/**
+ * @brief The function writes evaluation parameters to a parameter file. Each line holds the name of a parameter
+ * followed by its value, or by the BOARD_SIZE * BOARD_SIZE values of a piece square table.
+ *
+ * @param path is the path of the parameter file
+ * @param parameters is the evaluation parameters to write
+ *
+ * @return true if the file was written and false otherwise
+ */
+bool save_evaluation_parameters(const string &path, const evaluation_parameters &parameters);
+
+/**
+ * @brief Enum used to name the kernels which compute the piece square score of a whole board
+ */
+enum piece_square_kernel
+{
+    SCALAR_PIECE_SQUARE_KERNEL, // Adds up one tile at a time
+    AVX2_PIECE_SQUARE_KERNEL    // Gathers the scores of 8 tiles at a time
+};
+
+/**
+ * @brief The function computes the packed piece square score of a whole board from its piece codes. The board keeps
+ * this score up to date as pieces are placed or removed, so it is only used when there is no score to update: when
+ * a position is set up, when the kept score is verified and when many positions are evaluated at once.
+ *
+ * @param piece_codes is the piece code of every tile, see board::get_piece_codes
+ *
+ * @return the packed piece square score of white minus black
+ */
+int piece_square_rescan(const uint8_t *piece_codes);
+
+/**
+ * @brief The function chooses the kernel used by piece_square_rescan. The fastest one supported by the processor is
+ * chosen at startup.
+ *
+ * @param kernel is the kernel to use
+ *
+ * @return true if the processor supports the kernel and false otherwise
+ */
+bool set_piece_square_kernel(piece_square_kernel kernel);
+
+/**
+ * @brief The function returns the kernel used by piece_square_rescan
+ *
+ * @return the kernel
+ */
+piece_square_kernel get_piece_square_kernel();
+
+/**
+ * @brief The function evaluates every position of a file, one position in Forsyth-Edwards Notation per line, and
+ * logs the evaluations. Each position is also checked with board::verify_incremental_state. The time taken by the
+ * evaluations is logged at the end.
+ *
+ * @param path is the path of the file
+ *
+ * @return true if every position was valid and verified, and false otherwise
+ */
+bool batch_evaluate(const string &path);
+
+/**
+ * @brief The function loads the weights of the neural network from a file. The file starts with NNUE_FILE_MAGIC,
+ * NNUE_FILE_VERSION, NNUE_INPUT_SIZE, NNUE_HIDDEN_SIZE and NNUE_LAYER_SIZE as 32 bit integers, followed by the
+ * little endian weights and biases of each layer in this order:
+ * - int16 biases[NNUE_HIDDEN_SIZE] and int16 weights[NNUE_INPUT_SIZE][NNUE_HIDDEN_SIZE] of the first layer
+ * - int32 biases[NNUE_LAYER_SIZE] and int8 weights[NNUE_LAYER_SIZE][2 * NNUE_HIDDEN_SIZE] of the second layer
+ * - int32 biases[NNUE_LAYER_SIZE] and int8 weights[NNUE_LAYER_SIZE][NNUE_LAYER_SIZE] of the third layer
+ * - int32 bias and int8 weights[NNUE_LAYER_SIZE] of the output layer
+ * It must be called before any search, as the accumulators of the boards depend on the weights.
+ *
+ * @param path is the path of the network file
+ *
+ * @return true if the network was loaded and false otherwise
+ */
+bool load_nnue_network(const string &path);
+
+/**
+ * @brief The function checks if a neural network was loaded
+ *
+ * @return true if a neural network was loaded and false otherwise
+ */
+bool nnue_network_loaded();
+
+/**
+ * @brief The function chooses the function which evaluates the leaves of the search. The neural network can only be
+ * chosen once it is loaded.
+ *
+ * @param evaluator is the evaluator to use
+ *
+ * @return true if the evaluator was chosen and false otherwise
+ */
+bool set_evaluator(evaluator_type evaluator);
+
+/**
+ * @brief The function returns the function which evaluates the leaves of the search
+ *
+ * @return the evaluator
+ */
+evaluator_type get_evaluator();
+
+/**
+ * @brief The function returns the instruction set used by the neural network kernels. The fastest one supported by
+ * the processor is chosen at startup.
+ *
+ * @return the instruction set
+ */
+nnue_instruction_set get_nnue_instruction_set();
+
+/**
+ * @brief The function chooses the instruction set used by the neural network kernels, for example to compare the
+ * results of the vector kernels with the scalar ones
+ *
+ * @param instruction_set is the instruction set to use
+ *
+ * @return true if the processor supports the instruction set and false otherwise
+ */
+bool set_nnue_instruction_set(nnue_instruction_set instruction_set);
+
+/**
+ * @brief The function returns the index of the input of the neural network standing for a piece on a tile, seen from
+ * the king of a perspective. Black sees the board with the ranks flipped, so both perspectives look the same.
+ *
+ * @param perspective is the color of the king the piece is seen from
+ * @param king_tile is the tile of the king of the perspective, as rank * BOARD_SIZE + file
+ * @param piece is the piece, which must not be a king
+ * @param tile is the tile of the piece, as rank * BOARD_SIZE + file
+ *
+ * @return the index of the input
+ */
+int nnue_input_index(piece_color perspective, int king_tile, const chess_piece &piece, int tile);
+
+/**
+ * @brief The procedure sets an accumulator perspective to the biases of the first layer of the neural network, which
+ * is its value when no input is active
+ *
+ * @param values is the accumulator perspective, of NNUE_HIDDEN_SIZE values
+ */
+void nnue_reset_accumulator(int16_t *values);
+
+/**
+ * @brief The procedure adds the weights of an input of the first layer of the neural network to an accumulator
+ * perspective
+ *
+ * @param values is the accumulator perspective, of NNUE_HIDDEN_SIZE values
+ * @param input is the index of the input, see nnue_input_index
+ */
+void nnue_add_input(int16_t *values, int input);
+
+/**
+ * @brief The procedure removes the weights of an input of the first layer of the neural network from an accumulator
+ * perspective
+ *
+ * @param values is the accumulator perspective, of NNUE_HIDDEN_SIZE values
+ * @param input is the index of the input, see nnue_input_index
+ */
+void nnue_remove_input(int16_t *values, int input);
+
+/**
+ * @brief The function evaluates the board with the neural network. The accumulator of the board gives the first
+ * layer, so only the small layers are computed.
+ *
+ * @param the_board is the state of the board
+ * @param player_color is the color of the player to move. The network evaluates from the point of view of that player
+ *
+ * @return the evaluation, from white's point of view like the classic evaluation
+ */
+int nnue_evaluation(board &the_board, piece_color player_color);
 
 /**
  * @brief The function returns a vector containing all the possible squares 
@@ -823,16 +1731,75 @@ vector<square> possible_queen_moves(const square &start_square, const int max_di
  */
 vector<square> generate_possible_destination_squares(const square &start_square, const chess_piece &piece);
 
+/**
+ * @brief This function checks if the player has at least one legal move. It stops at the first legal move found,
+ * which makes it much cheaper than generating all the legal moves when we only need to know if there is a checkmate
+ * or a stalemate.
+ *
+ * @param the_board is the state of the board
+ * @param player_color is the color of the player
+ *
+ * @return true if the player can play a legal move and false otherwise
+ */
+bool has_legal_move(board &the_board, piece_color player_color);
+
+/**
+ * @brief This function checks if a move captures a piece, including en passant captures
+ *
+ * @param the_board is the state of the board before the move is played
+ * @param current_move is the move to check
+ *
+ * @return true if the move is a capture and false otherwise
+ */
+bool is_capture_move(const board &the_board, const move &current_move);
+
+/**
+ * @brief This function checks if a capture wins material outright, that is the piece captured is worth more than
+ * the capturing piece or the destination square is not defended by the opponent
+ *
+ * @param the_board is the state of the board before the move is played
+ * @param current_move is the capture to check
+ *
+ * @return true if the capture wins material and false otherwise
+ */
+bool capture_wins_material(const board &the_board, const move &current_move);
+
+/**
+ * @brief This procedure sorts the quiet moves of a position searched by minimax, best first. Moves are scored using
+ * the continuation history of the moves played one and two plies earlier, and the countermove of the previous
+ * move is put in front of all the others.
+ *
+ * @param the_board is the state of the board
+ * @param quiet_moves are the quiet moves to sort
+ * @param ply is the number of moves played from the root of the search to reach this position
+ */
+void order_quiet_moves(const board &the_board, vector<move> &quiet_moves, int ply);
+
+/**
+ * @brief This procedure is called when a move causes a beta cutoff in minimax. If the move is a quiet move, it becomes
+ * the countermove of the previous move and its continuation history is increased, while the quiet moves searched
+ * before it without causing a cutoff are penalized.
+ *
+ * @param the_board is the state of the board
+ * @param legal_moves are the moves of the position, in the order they were searched
+ * @param cutoff_index is the index of the move which caused the cutoff
+ * @param depth is the depth at which the position was searched
+ * @param ply is the number of moves played from the root of the search to reach this position
+ */
+void update_quiet_move_history(const board &the_board, const vector<move> &legal_moves, int cutoff_index, int depth, int ply);
+
 /**
  * @brief This function takes in the board state and the player color. It then returns all the legal moves that the player
  * can play on the board state
  *
  * @param the_board is the state of the board
  * @param player_color is the color of the pieces of the current player's turn
+ * @param ply is the ply of the position in the search, used to order the quiet moves. It is NO_SEARCH_PLY when the moves
+ * are not generated by the search, in which case quiet moves are left in the order they are found on the board
  *
  * @return the vector containing all the legal moves that the player can play on this board state
  */
-vector<move> generate_legal_moves(board &the_board, piece_color player_color);
+vector<move> generate_legal_moves(board &the_board, piece_color player_color, int ply = NO_SEARCH_PLY);
 
 /**
  * @brief This function checks if a white pawn reached a promotion square and if it did., it automatically
@@ -882,11 +1849,45 @@ void undo_black_pawn_promotion(board &the_board, const move &move_made);
  * @param beta is the beta value used for alpha-beta pruning
  * @param maximizing_player is a boolean value used to state if it is WHITE'turn (true)
  * or BLACK's turn(false)
+ * @param ply is the number of moves played from the root of the search to reach this position
  *
  * @return the evaluation for the move played
  *
  */
-int minimax(const board &the_board, int depth, int alpha, int beta, bool maximizing_player);
+int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_player, int ply);
+
+/**
+ * @brief This function plays a move on the board, searches the resulting position with minimax and then
+ * undoes the move. Pawns reaching a promotion square are temporarily promoted to a queen.
+ *
+ * @param the_board is the board state
+ * @param move_made is the move to search
+ * @param depth is the depth at which the position after the move is searched
+ * @param alpha is the alpha value used for alpha-beta pruning
+ * @param beta is the beta value used for alpha-beta pruning
+ * @param maximizing_player is true if WHITE is the player making the move and false if it is BLACK
+ * @param ply is the ply of the position before the move is played
+ *
+ * @return the evaluation of the position after the move
+ */
+int search_move(board &the_board, const move &move_made, int depth, int alpha, int beta, bool maximizing_player, int ply);
+
+/**
+ * @brief This function checks if the first move in the list is singular, that is all the other moves are clearly
+ * worse than it. Every other move is searched at a reduced depth against a bound set SINGULAR_EXTENSION_MARGIN
+ * below the evaluation of the first move, and the first move is singular if none of them reaches that bound.
+ *
+ * @param the_board is the board state
+ * @param legal_moves are the legal moves in the position, the candidate move being the first one
+ * @param depth is the depth at which the position is being searched
+ * @param candidate_evaluation is the evaluation found for the candidate move by a shallower search
+ * @param maximizing_player is a boolean value used to state if it is WHITE'turn (true)
+ * or BLACK's turn(false)
+ * @param ply is the number of moves played from the root of the search to reach this position
+ *
+ * @return true if the candidate move is singular and false otherwise
+ */
+bool is_singular_move(board &the_board, const vector<move> &legal_moves, int depth, int candidate_evaluation, bool maximizing_player, int ply);
 
 /**
  * @brief This function automatically promotes a pawn to a queen if that pawn has reached a promotion square.
@@ -913,6 +1914,62 @@ bool promote_pawn_to_queen(board &the_board, const chess_piece &moved_piece, con
  */
 void unpromote_pawn_from_queen(board &the_board, const move &move_made, const piece_color player_color);
 
+/**
+ * @brief This function returns the statistics of the searches run by the current thread since they were last reset
+ *
+ * @return the search statistics
+ */
+const search_statistics &get_search_statistics();
+
+/**
+ * @brief This procedure resets the search statistics of the current thread
+ */
+void reset_search_statistics();
+
+/**
+ * @brief This procedure logs the search statistics of the current thread: the number of nodes searched, the hit rate
+ * of the evaluation cache and the estimated speedup it brings to the evaluation. The speedup compares the time the
+ * evaluations took with the time they would have taken if the cache hits had cost as much as the misses. Only one
+ * evaluation in EVALUATION_PROFILE_SAMPLE_RATE is timed, so the speedup is estimated from that sample.
+ */
+void log_search_statistics();
+
+/**
+ * @brief The procedure turns the evaluation trace mode on or off. In trace mode, the handcrafted evaluation measures
+ * the processor cycles spent in each of its steps for one evaluation in EVALUATION_PROFILE_SAMPLE_RATE, and
+ * log_search_statistics logs the average cost of each step. The position at the root of each search and the
+ * positions evaluated by batch_evaluate are traced with log_evaluation_trace.
+ *
+ * @param enabled is true to turn the trace mode on
+ */
+void set_evaluation_tracing(bool enabled);
+
+/**
+ * @brief The function tells if the evaluation trace mode is on
+ *
+ * @return true if the trace mode is on, and false otherwise
+ */
+bool evaluation_tracing_enabled();
+
+/**
+ * @brief The function computes the value of each handcrafted evaluation term for each player, as evaluate_board
+ * would with the terms of ENGINE_EVALUATION_FEATURES. The lazy evaluation is never applied, and the terms left out of
+ * the feature set are zero.
+ *
+ * @param the_board is the state of the board
+ *
+ * @return the evaluation trace of the position
+ */
+evaluation_trace trace_evaluation(board &the_board);
+
+/**
+ * @brief The procedure logs the evaluation trace of a position as a table with a row per term, and a column per
+ * player followed by the difference
+ *
+ * @param the_board is the state of the board
+ */
+void log_evaluation_trace(board &the_board);
+
 /**
  * @brief This function is the entry point for the AI program. It uses the minimax algorithm to find and 
  * return the best move the current player can play.
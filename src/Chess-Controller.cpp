@@ -1,10 +1,579 @@
 #include "Chess-Model.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <initializer_list>
+#include <cctype>
 #include <cmath>
 #include <format>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <stack>
 
-using std::abs, std::find, std::vector, std::stack, std::max, std::min;
+// x86-64 processors can run the AVX2 piece square kernel, and they all have a time stamp counter
+#if defined(__x86_64__) || defined(_M_X64)
+#define PIECE_SQUARE_AVX2
+#define TIME_STAMP_COUNTER
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+using std::abs, std::find, std::vector, std::stack, std::max, std::min, std::rotate, std::stable_sort, std::popcount, std::countr_zero,
+    std::countl_zero, std::ifstream, std::istringstream;
+
+/**
+ * @brief struct holding the random numbers used to build the Zobrist key of a position. The key of a position
+ * is the XOR of the numbers of every piece on its square, of the castling flags, of the en passant file and of
+ * the player to move, so it can be updated with a few XORs each time the board changes.
+ */
+struct zobrist_keys
+{
+    uint64_t pieces[LAST_COLOR][TYPE_OF_PIECE_COUNT][BOARD_SIZE * BOARD_SIZE]; // One number per piece per square
+    uint64_t castling[64];                                                    // One number per combination of castling flags
+    uint64_t en_passant_file[BOARD_SIZE];                                     // One number per en passant file
+    uint64_t black_to_move;                                                   // Added to the key when black is to move
+};
+
+/**
+ * @brief This function returns the next number of a splitmix64 pseudo random sequence
+ *
+ * @param state is the state of the sequence, which is advanced
+ *
+ * @return the pseudo random number
+ */
+constexpr uint64_t next_random_number(uint64_t &state)
+{
+    uint64_t number = (state += 0x9E3779B97F4A7C15ULL);
+    number = (number ^ (number >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    number = (number ^ (number >> 27)) * 0x94D049BB133111EBULL;
+    return number ^ (number >> 31);
+}
+
+/**
+ * @brief This function fills the Zobrist numbers. It runs at compile time so every run of the program uses the same keys
+ *
+ * @return the Zobrist numbers
+ */
+constexpr zobrist_keys generate_zobrist_keys()
+{
+    zobrist_keys keys = {};
+    uint64_t state = 0x43686573734149ULL;
+
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+        {
+            for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile++)
+            {
+                keys.pieces[color][type][tile] = next_random_number(state);
+            }
+        }
+    }
+
+    for (int flags = 0; flags < 64; flags++)
+    {
+        keys.castling[flags] = next_random_number(state);
+    }
+
+    for (int file = 0; file < BOARD_SIZE; file++)
+    {
+        keys.en_passant_file[file] = next_random_number(state);
+    }
+
+    keys.black_to_move = next_random_number(state);
+
+    return keys;
+}
+
+static constexpr zobrist_keys ZOBRIST = generate_zobrist_keys();
+
+/**
+ * @brief struct holding the packed middlegame and endgame score of every piece on every tile. Each score is the
+ * weighted value of the piece plus its weighted piece square table score, so a piece is scored with a single load.
+ * Scores of black pieces are mirrored and negated, so the scores of all the pieces can simply be added up.
+ */
+struct piece_square_scores
+{
+    int scores[TYPE_OF_PIECE_COUNT][LAST_COLOR][BOARD_SIZE * BOARD_SIZE]; // Packed score of each piece of each color on each tile
+};
+
+/**
+ * @brief This function applies an evaluation weight to a score, rounding to the nearest integer
+ *
+ * @param score is the score to weight
+ * @param weight_percentage is the weight in percent
+ *
+ * @return the weighted score
+ */
+constexpr int weighted_score(int score, int weight_percentage)
+{
+    return (score * weight_percentage + (score >= 0 ? 1 : -1) * EVALUATION_WEIGHT_SCALE / 2) / EVALUATION_WEIGHT_SCALE;
+}
+
+/**
+ * @brief This function returns the default evaluation parameters, made of the constants and piece tables of
+ * Chess-Model.h. It runs at compile time.
+ *
+ * @return the default evaluation parameters
+ */
+constexpr evaluation_parameters default_evaluation_parameters()
+{
+    // The opening tables are used for the middlegame. The queen has a single table for the whole game
+    const int (*middlegame_tables[TYPE_OF_PIECE_COUNT])[BOARD_SIZE] = {pawn_piece_table_opening, knight_piece_table_opening,
+                                                                       bishop_piece_table_opening, rook_piece_table_opening,
+                                                                       queen_piece_table, king_piece_table_opening};
+    const int (*endgame_tables[TYPE_OF_PIECE_COUNT])[BOARD_SIZE] = {pawn_piece_table_endgame, knight_piece_table_endgame,
+                                                                    bishop_piece_table_endgame, rook_piece_table_endgame,
+                                                                    queen_piece_table, king_piece_table_endgame};
+    evaluation_parameters parameters = {{MATERIAL_EVALUATION_WEIGHT_PERCENTAGE, POSITIONAL_EVALUATION_WEIGHT_PERCENTAGE,
+                                         MOBILITY_EVALUATION_WEIGHT_PERCENTAGE, KING_SAFETY_EVALUATION_WEIGHT_PERCENTAGE,
+                                         PAWN_STRUCTURE_EVALUATION_WEIGHT_PERCENTAGE, CENTER_CONTROL_EVALUATION_WEIGHT_PERCENTAGE,
+                                         THREAT_EVALUATION_WEIGHT_PERCENTAGE, PAWN_DEFENDER_SCORE, DOUBLE_PAWN_PENALTY,
+                                         ISOLATED_PAWN_PENALTY, BACKWARD_PAWN_PENALTY, CONNECTED_PAWN_BONUS}, {}};
+
+    for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+    {
+        for (int rank = 0; rank < BOARD_SIZE; rank++)
+        {
+            for (int file = 0; file < BOARD_SIZE; file++)
+            {
+                parameters.piece_tables[type][MIDDLEGAME_STAGE][rank * BOARD_SIZE + file] = middlegame_tables[type][rank][file];
+                parameters.piece_tables[type][ENDGAME_STAGE][rank * BOARD_SIZE + file] = endgame_tables[type][rank][file];
+            }
+        }
+    }
+
+    return parameters;
+}
+
+/**
+ * @brief This function folds the piece values and the middlegame and endgame piece square tables into a single
+ * table. It runs at compile time for the default parameters.
+ *
+ * @param parameters is the evaluation parameters holding the piece tables and the material and positional weights
+ *
+ * @return the packed scores of every piece on every tile
+ */
+constexpr piece_square_scores generate_piece_square_scores(const evaluation_parameters &parameters)
+{
+    int material_weight = parameters.scalars[MATERIAL_WEIGHT_PARAMETER];
+    int positional_weight = parameters.scalars[POSITIONAL_WEIGHT_PARAMETER];
+    piece_square_scores table = {};
+
+    for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+    {
+        // Kings are always on the board, so their value would cancel out
+        int piece_value = (type == KING) ? 0 : weighted_score(PIECE_VALUE[type], material_weight);
+        const int *middlegame_table = parameters.piece_tables[type][MIDDLEGAME_STAGE];
+        const int *endgame_table = parameters.piece_tables[type][ENDGAME_STAGE];
+
+        for (int rank = 0; rank < BOARD_SIZE; rank++)
+        {
+            for (int file = 0; file < BOARD_SIZE; file++)
+            {
+                int score = make_score(piece_value + weighted_score(middlegame_table[rank * BOARD_SIZE + file], positional_weight),
+                                       piece_value + weighted_score(endgame_table[rank * BOARD_SIZE + file], positional_weight));
+
+                // Piece tables are written from white's point of view, so they are flipped vertically for black pieces
+                table.scores[type][WHITE][rank * BOARD_SIZE + file] = score;
+                table.scores[type][BLACK][(BOARD_SIZE - 1 - rank) * BOARD_SIZE + file] = -score;
+            }
+        }
+    }
+
+    return table;
+}
+
+// Evaluation parameters in use, and the piece square scores folded from them
+static evaluation_parameters parameters = default_evaluation_parameters();
+static piece_square_scores piece_square_score_table = generate_piece_square_scores(default_evaluation_parameters());
+
+/**
+ * @brief Enum used to name the directions in which rooks, bishops and queens slide. The directions towards higher
+ * bits of a bitboard come first, so the closest piece on a ray is its lowest bit for them and its highest bit for the others
+ */
+enum ray_direction
+{
+    FILE_UP,        // Towards file 7
+    RANK_UP,        // Towards rank 7
+    RANK_UP_FILE_UP,
+    RANK_UP_FILE_DOWN,
+    FILE_DOWN,      // Towards file 0
+    RANK_DOWN,      // Towards rank 0
+    RANK_DOWN_FILE_DOWN,
+    RANK_DOWN_FILE_UP,
+    RAY_DIRECTION_COUNT
+};
+
+// Rank and file steps of each ray direction
+constexpr int RAY_RANK_STEP[RAY_DIRECTION_COUNT] = {0, 1, 1, 1, 0, -1, -1, -1};
+constexpr int RAY_FILE_STEP[RAY_DIRECTION_COUNT] = {1, 0, 1, -1, -1, 0, -1, 1};
+
+/**
+ * @brief This function returns the bitboard of a tile, or an empty bitboard if the tile is off the board
+ *
+ * @param rank is the rank of the tile
+ * @param file is the file of the tile
+ *
+ * @return the bitboard of the tile
+ */
+constexpr uint64_t tile_bitboard(int rank, int file)
+{
+    if (rank < 0 || rank >= BOARD_SIZE || file < 0 || file >= BOARD_SIZE)
+    {
+        return 0;
+    }
+
+    return 1ULL << (rank * BOARD_SIZE + file);
+}
+
+/**
+ * @brief struct holding bitboard masks used by the evaluation. Bit rank * BOARD_SIZE + file of a bitboard stands for
+ * the tile at that rank and file.
+ */
+struct bitboard_masks
+{
+    uint64_t file[BOARD_SIZE];                                       // Tiles of each file
+    uint64_t adjacent_files[BOARD_SIZE];                             // Tiles of the files next to each file
+    uint64_t passed_pawn_span[LAST_COLOR][BOARD_SIZE * BOARD_SIZE]; // Tiles in front of a pawn, on its file and the adjacent
+                                                                     // ones. The pawn is passed if no enemy pawn is on them
+    uint64_t knight_attacks[BOARD_SIZE * BOARD_SIZE];               // Tiles attacked by a knight on each tile
+    uint64_t king_attacks[BOARD_SIZE * BOARD_SIZE];                 // Tiles attacked by a king on each tile
+    uint64_t king_zone[LAST_COLOR][BOARD_SIZE * BOARD_SIZE];        // Tiles around a king on each tile, with one more rank
+                                                                     // in front of it, where enemy attacks threaten the king
+    uint64_t rays[RAY_DIRECTION_COUNT][BOARD_SIZE * BOARD_SIZE];    // Tiles from each tile to the edge of the board in each
+                                                                     // direction, the tile itself excluded
+};
+
+/**
+ * @brief This function fills the bitboard masks at compile time
+ *
+ * @return the bitboard masks
+ */
+constexpr bitboard_masks generate_bitboard_masks()
+{
+    bitboard_masks masks = {};
+
+    for (int file = 0; file < BOARD_SIZE; file++)
+    {
+        for (int rank = 0; rank < BOARD_SIZE; rank++)
+        {
+            masks.file[file] |= 1ULL << (rank * BOARD_SIZE + file);
+        }
+    }
+
+    for (int file = 0; file < BOARD_SIZE; file++)
+    {
+        masks.adjacent_files[file] = (file > 0 ? masks.file[file - 1] : 0) | (file < BOARD_SIZE - 1 ? masks.file[file + 1] : 0);
+    }
+
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            uint64_t files = masks.file[file] | masks.adjacent_files[file];
+
+            // White pawns move towards rank 0 and black pawns towards rank 7
+            for (int front_rank = 0; front_rank < BOARD_SIZE; front_rank++)
+            {
+                uint64_t rank_tiles = 0xFFULL << (front_rank * BOARD_SIZE);
+
+                if (front_rank < rank)
+                {
+                    masks.passed_pawn_span[WHITE][rank * BOARD_SIZE + file] |= files & rank_tiles;
+                }
+                else if (front_rank > rank)
+                {
+                    masks.passed_pawn_span[BLACK][rank * BOARD_SIZE + file] |= files & rank_tiles;
+                }
+            }
+
+            int tile = rank * BOARD_SIZE + file;
+
+            // Knights jump 2 tiles in one direction and 1 tile in the other
+            for (int rank_step = -2; rank_step <= 2; rank_step++)
+            {
+                for (int file_step = -2; file_step <= 2; file_step++)
+                {
+                    if (abs(rank_step) + abs(file_step) == 3)
+                    {
+                        masks.knight_attacks[tile] |= tile_bitboard(rank + rank_step, file + file_step);
+                    }
+                }
+            }
+
+            // Kings and sliding pieces move in the same 8 directions
+            for (int direction = 0; direction < RAY_DIRECTION_COUNT; direction++)
+            {
+                masks.king_attacks[tile] |= tile_bitboard(rank + RAY_RANK_STEP[direction], file + RAY_FILE_STEP[direction]);
+
+                for (int step = 1; step < BOARD_SIZE; step++)
+                {
+                    masks.rays[direction][tile] |= tile_bitboard(rank + step * RAY_RANK_STEP[direction], file + step * RAY_FILE_STEP[direction]);
+                }
+            }
+
+            // The king zone spans 3 files and 4 ranks, from the rank behind the king to 2 ranks in front of it
+            for (int file_step = -1; file_step <= 1; file_step++)
+            {
+                for (int rank_step = -1; rank_step <= 2; rank_step++)
+                {
+                    // White moves towards rank 0 and black towards rank 7
+                    masks.king_zone[WHITE][tile] |= tile_bitboard(rank - rank_step, file + file_step);
+                    masks.king_zone[BLACK][tile] |= tile_bitboard(rank + rank_step, file + file_step);
+                }
+            }
+        }
+    }
+
+    return masks;
+}
+
+static constexpr bitboard_masks BITBOARD_MASKS = generate_bitboard_masks();
+
+/**
+ * @brief This function moves every tile of a bitboard one rank forward from the point of view of a color
+ *
+ * @param tiles is the bitboard
+ * @param color is the color whose forward direction is used. White moves towards rank 0 and black towards rank 7
+ *
+ * @return the shifted bitboard
+ */
+static uint64_t shift_forward(uint64_t tiles, piece_color color)
+{
+    return (color == WHITE) ? tiles >> BOARD_SIZE : tiles << BOARD_SIZE;
+}
+
+/**
+ * @brief This function moves every tile of a bitboard one file towards file 7, dropping the tiles of file 7
+ *
+ * @param tiles is the bitboard
+ *
+ * @return the shifted bitboard
+ */
+static uint64_t shift_file_up(uint64_t tiles)
+{
+    return (tiles & ~BITBOARD_MASKS.file[BOARD_SIZE - 1]) << 1;
+}
+
+/**
+ * @brief This function moves every tile of a bitboard one file towards file 0, dropping the tiles of file 0
+ *
+ * @param tiles is the bitboard
+ *
+ * @return the shifted bitboard
+ */
+static uint64_t shift_file_down(uint64_t tiles)
+{
+    return (tiles & ~BITBOARD_MASKS.file[0]) >> 1;
+}
+
+/**
+ * @brief This function returns all the tiles in front of the tiles of a bitboard, on the same files, from the
+ * point of view of a color. The tiles of the bitboard themselves are not included unless another tile is behind them.
+ *
+ * @param tiles is the bitboard
+ * @param color is the color whose forward direction is used
+ *
+ * @return the tiles in front
+ */
+static uint64_t forward_span(uint64_t tiles, piece_color color)
+{
+    tiles = shift_forward(tiles, color);
+
+    if (color == WHITE)
+    {
+        tiles |= tiles >> BOARD_SIZE;
+        tiles |= tiles >> (2 * BOARD_SIZE);
+        tiles |= tiles >> (4 * BOARD_SIZE);
+    }
+    else
+    {
+        tiles |= tiles << BOARD_SIZE;
+        tiles |= tiles << (2 * BOARD_SIZE);
+        tiles |= tiles << (4 * BOARD_SIZE);
+    }
+
+    return tiles;
+}
+
+/**
+ * @brief This function returns the tiles attacked by the pawns of a bitboard
+ *
+ * @param pawns is the bitboard of the pawns
+ * @param color is the color of the pawns
+ *
+ * @return the tiles attacked by the pawns
+ */
+static uint64_t pawn_attacks(uint64_t pawns, piece_color color)
+{
+    uint64_t pawns_pushed = shift_forward(pawns, color);
+
+    return shift_file_up(pawns_pushed) | shift_file_down(pawns_pushed);
+}
+
+/**
+ * @brief This function returns the files on which there is at least one tile of a bitboard
+ *
+ * @param tiles is the bitboard
+ *
+ * @return bit n is set if there is a tile on file n
+ */
+static uint8_t occupied_files(uint64_t tiles)
+{
+    tiles |= tiles >> (4 * BOARD_SIZE);
+    tiles |= tiles >> (2 * BOARD_SIZE);
+    tiles |= tiles >> BOARD_SIZE;
+
+    return (uint8_t)tiles;
+}
+
+/**
+ * @brief This function returns the tiles attacked by a piece sliding from a tile in a range of directions. Each ray
+ * stops at the first occupied tile, which is attacked.
+ *
+ * @param tile is the tile of the sliding piece
+ * @param occupied is the bitboard of all the pieces on the board
+ * @param directions are the directions in which the piece slides
+ *
+ * @return the attacked tiles
+ */
+static uint64_t sliding_attacks(int tile, uint64_t occupied, std::initializer_list<ray_direction> directions)
+{
+    uint64_t attacks = 0;
+
+    for (ray_direction direction : directions)
+    {
+        uint64_t ray = BITBOARD_MASKS.rays[direction][tile];
+        uint64_t blockers = ray & occupied;
+
+        // Cutting the ray behind the closest blocker
+        if (blockers)
+        {
+            int closest_blocker = (direction < FILE_DOWN) ? countr_zero(blockers) : 63 - countl_zero(blockers);
+            ray ^= BITBOARD_MASKS.rays[direction][closest_blocker];
+        }
+
+        attacks |= ray;
+    }
+
+    return attacks;
+}
+
+/**
+ * @brief This function returns the tiles attacked by a piece, whether they are empty or occupied by any piece
+ *
+ * @param piece is the piece
+ * @param tile is the tile of the piece, as rank * BOARD_SIZE + file
+ * @param occupied is the bitboard of all the pieces on the board
+ *
+ * @return the attacked tiles
+ */
+static uint64_t piece_attacks(const chess_piece &piece, int tile, uint64_t occupied)
+{
+    switch (piece.type)
+    {
+    case PAWN:
+        return pawn_attacks(1ULL << tile, piece.color);
+    case KNIGHT:
+        return BITBOARD_MASKS.knight_attacks[tile];
+    case BISHOP:
+        return sliding_attacks(tile, occupied, {RANK_UP_FILE_UP, RANK_UP_FILE_DOWN, RANK_DOWN_FILE_DOWN, RANK_DOWN_FILE_UP});
+    case ROOK:
+        return sliding_attacks(tile, occupied, {FILE_UP, RANK_UP, FILE_DOWN, RANK_DOWN});
+    case QUEEN:
+        return sliding_attacks(tile, occupied, {FILE_UP, RANK_UP, RANK_UP_FILE_UP, RANK_UP_FILE_DOWN,
+                                                FILE_DOWN, RANK_DOWN, RANK_DOWN_FILE_DOWN, RANK_DOWN_FILE_UP});
+    case KING:
+        return BITBOARD_MASKS.king_attacks[tile];
+    default:
+        return 0;
+    }
+}
+
+// Pawn hash table of the thread. An entry is found from the lower bits of the pawn key. The entries start with a pawn
+// key of 0, which is the key of a board without pawns, whose evaluation and pawn files are all 0 as well
+static thread_local pawn_hash_entry pawn_hash_table[PAWN_HASH_TABLE_SIZE];
+
+// Material hash table of the thread. An entry is found by mixing the bits of the material signature
+static thread_local material_hash_entry material_hash_table[MATERIAL_HASH_TABLE_SIZE];
+
+// Evaluation cache of the thread. An entry is found from the lower bits of the position key and replaced by the most
+// recent evaluation, so evaluations are lost whenever two positions share an entry
+static thread_local evaluation_cache_entry evaluation_cache[EVALUATION_CACHE_SIZE];
+
+// Statistics of the searches of the thread
+static thread_local search_statistics statistics;
+
+/**
+ * @brief This function returns the number of nanoseconds elapsed since an arbitrary point, used to time the evaluation
+ *
+ * @return the current time in nanoseconds
+ */
+static uint64_t current_nanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief This function returns the time stamp counter of the processor, used to sample the cost of each step of the
+ * evaluation. Processors without a time stamp counter count nanoseconds instead
+ *
+ * @return the current number of cycles
+ */
+static uint64_t current_cycles()
+{
+#ifdef TIME_STAMP_COUNTER
+    return __rdtsc();
+#else
+    return current_nanoseconds();
+#endif
+}
+
+// Evaluation trace mode, and the number of handcrafted evaluations of the thread, used to sample one in
+// EVALUATION_PROFILE_SAMPLE_RATE
+static bool evaluation_tracing = false;
+static thread_local uint64_t profile_counter = 0;
+
+/**
+ * @brief The procedure adds the cycles elapsed since the end of the previous step of a sampled evaluation to the cost
+ * of a step, then starts timing the next step
+ *
+ * @param profiled is true if the evaluation is sampled. Nothing is done otherwise
+ * @param step_start is the cycle count at the start of the step, updated to the start of the next step
+ * @param cost is the step which ends
+ */
+static void record_evaluation_cost(bool profiled, uint64_t &step_start, evaluation_cost cost)
+{
+    if (profiled)
+    {
+        uint64_t now = current_cycles();
+
+        statistics.evaluation_cycles[cost] += now - step_start;
+        step_start = now;
+    }
+}
+
+/**
+ * @brief This function returns the Zobrist number of a piece standing on a tile. An empty tile has no number
+ *
+ * @param piece is the chess piece
+ * @param tile is the tile on which the piece is found
+ *
+ * @return the Zobrist number of the piece on that tile
+ */
+static uint64_t piece_key(const chess_piece &piece, const square &tile)
+{
+    if (piece.type == NONE)
+    {
+        return 0;
+    }
+
+    return ZOBRIST.pieces[piece.color][piece.type][tile.rank * BOARD_SIZE + tile.file];
+}
 
 board::board()
 {
@@ -62,1402 +631,2675 @@ board::board()
 
     // Initializing en_passant target
     this->en_passant_target = {-1, -1};
-}
-
-void board::set_en_passant_target(const square potential_en_passant_target)
-{
-    this->en_passant_target = potential_en_passant_target;
-}
-
-square board::get_en_passant_target() const
-{
-    return this->en_passant_target;
-}
-
-void board::reset_en_passant_target()
-{
-    this->en_passant_target = {-1, -1};
-}
 
-chess_piece board::get_piece_at(int rank, int file) const
-{
-    return this->chess_board[rank][file];
+    // Initializing the keys, material signature, piece square score, phase weight and bitboards
+    this->initialize_incremental_state();
 }
 
-void board::set_piece_at(square tile, chess_piece piece)
+void board::initialize_incremental_state()
 {
-    this->chess_board[tile.rank][tile.file] = piece;
-}
+    uint8_t piece_codes[BOARD_SIZE * BOARD_SIZE];
 
-void board::move_piece(const move &current_move)
-{
-    square from = current_move.from;
-    square to = current_move.to;
-    move_history_data move_data;
-    chess_piece moving_piece = this->get_piece_at(from.rank, from.file);
-    chess_piece captured_piece = this->get_piece_at(to.rank, to.file);
+    this->position_key = this->compute_position_key();
+    this->pawn_key = this->compute_pawn_key();
+    this->material_signature = this->compute_material_signature();
 
-    // Updating the move history
-    move_data.move_made = current_move;
-    move_data.moved_piece = moving_piece;
-    move_data.king_side_castle = false;
-    move_data.queen_side_castle = false;
-    move_data.en_passant_capture = false;
-    move_data.en_passant_opportunity = false;
-    move_data.en_passant_opportunity_square = {-1, -1};
-    move_data.prev_white_king_moved = this->get_white_king_moved();
-    move_data.prev_black_king_moved = this->get_black_king_moved();
-    move_data.prev_white_rook_a_moved = this->get_white_rook_a_moved();
-    move_data.prev_white_rook_h_moved = this->get_white_rook_h_moved();
-    move_data.prev_black_rook_a_moved = this->get_black_rook_a_moved();
-    move_data.prev_black_rook_h_moved = this->get_black_rook_h_moved();
+    // The piece square score of the whole board is computed at once
+    this->get_piece_codes(piece_codes);
+    this->piece_square_score = piece_square_rescan(piece_codes);
 
-    // Difference in rank of the piece position caused by the move
-    int rank_difference = to.rank - from.rank;
-    // Difference in file of the piece position caused by the move
-    int file_difference = to.file - from.file;
+    this->phase_weight = 0;
 
-    // Checking for castling move
-    if (moving_piece.type == KING && abs(file_difference) == 2)
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
     {
-        if (to.file == 6) // Kingside castling
-        {
-            move_data.king_side_castle = true;
-            // Moving the h file rook for the king side castle
-            this->chess_board[from.rank][5] = this->chess_board[from.rank][BOARD_SIZE - 1];
-            this->chess_board[from.rank][BOARD_SIZE - 1] = {NONE, WHITE};
-        }
-        else if (to.file == 2) // Queen side castling
+        this->color_bitboards[color] = 0;
+
+        for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
         {
-            move_data.queen_side_castle = true;
-            // Moving the a file rook for the queen side castle
-            this->chess_board[from.rank][3] = this->chess_board[from.rank][0];
-            this->chess_board[from.rank][0] = {NONE, WHITE};
+            this->piece_bitboards[color][type] = 0;
         }
     }
 
-    if (moving_piece.type == PAWN)
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
     {
-        square potential_en_passant_target = this->get_en_passant_target();
-        // Checking if it is a valid en passant capture attempt
-        if (potential_en_passant_target.rank == to.rank && potential_en_passant_target.file == to.file && abs(file_difference) == 1 && this->chess_board[to.rank][to.file].type == NONE)
+        for (int file = 0; file < BOARD_SIZE; file++)
         {
-            // The rank of the pawn which we are trying to capture by en passant
-            int captured_pawn_rank;
+            chess_piece piece = this->chess_board[rank][file];
 
-            // Getting the rank of the pawn which we are trying to capture by en passant, based on the piece color
-            if (moving_piece.color == WHITE)
+            if (piece.type != NONE)
             {
-                captured_pawn_rank = to.rank + 1; // Add one as black pawns move in +1 steps
-            }
-            else
-            {
-                captured_pawn_rank = to.rank - 1; // Minus one as white pawns move in -1 steps
-            }
-
-            // Chess piece being captured
-            chess_piece potential_pawn_capture = this->chess_board[captured_pawn_rank][to.file];
-
-            // Must check if it is a pawn of the opposite color before capturing it
-            if (potential_pawn_capture.type == PAWN && potential_pawn_capture.color != moving_piece.color)
-            {
-                captured_piece = this->chess_board[captured_pawn_rank][to.file];
-                // Removing the captured pawn from the board
-                this->chess_board[captured_pawn_rank][to.file] = {NONE, WHITE};
-                // Setting en passant capture flag to true
-                move_data.en_passant_capture = true;
+                this->phase_weight += PIECE_PHASE_WEIGHT[piece.type];
+                this->toggle_piece_bitboards(piece, {rank, file});
             }
         }
+    }
 
-        // If the pawn we have moved, has moved by 2 ranks, it is a potential en passant capture
-        if (abs(rank_difference) == 2)
+    // The accumulators of the neural network are computed the next time they are needed
+    this->accumulator.computed[WHITE] = this->accumulator.computed[BLACK] = false;
+}
+
+void board::get_piece_codes(uint8_t *piece_codes) const
+{
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
         {
-            int en_passant_rank = (from.rank + to.rank) / 2;                        // Getting the rank of the en passant target, if it is captured
-            this->set_en_passant_target({en_passant_rank, from.file});              // Creating the en passant target
-            move_data.en_passant_opportunity = true;                                // Creating en-passant capture opportunity for this move in move history
-            move_data.en_passant_opportunity_square = {en_passant_rank, from.file}; // Getting the en passant target for this en passant opportunity
+            piece_codes[rank * BOARD_SIZE + file] = (uint8_t)piece_code(this->chess_board[rank][file]);
         }
     }
+}
 
-    // If we did not move a pawn by 2 ranks this move, it means there is no en passant target for the next move
-    if (!(moving_piece.type == PAWN && abs(rank_difference) == 2))
+bool board::load_fen(const string &fen)
+{
+    istringstream fields(fen);
+    string placement;
+    string active_color;
+    string castling;
+    string en_passant;
+    int halfmove_clock = 0;
+
+    if (!(fields >> placement >> active_color >> castling >> en_passant))
     {
-        this->reset_en_passant_target();
+        return false;
     }
 
-    // Recording piece capture in move_data
-    move_data.piece_captured = captured_piece;
-
-    // Updating the vectors keeping track of the number of pieces on the board
-    if (captured_piece.color != moving_piece.color && captured_piece.type != NONE)
+    // The halfmove clock may be left out, and the fullmove number is not used
+    if (!(fields >> halfmove_clock))
     {
-        if (captured_piece.color == WHITE)
-        {
-            // The data type of index_of_piece_to_remove will be generated dynamically
-            auto index_of_piece_to_remove = find(this->white_pieces_remaining.begin(), this->white_pieces_remaining.end(), captured_piece.type);
-
-            // Checking if the piece has been found first
-            if (index_of_piece_to_remove != this->white_pieces_remaining.end())
-            {
-                this->white_pieces_remaining.erase(index_of_piece_to_remove);
-            }
-        }
-        else
-        {
-            // The data type of index_of_piece_to_remove will be generated dynamically
-            auto index_of_piece_to_remove = find(this->black_pieces_remaining.begin(), this->black_pieces_remaining.end(), captured_piece.type);
-
-            // Checking if the piece has been found first
-            if (index_of_piece_to_remove != this->black_pieces_remaining.end())
-            {
-                this->black_pieces_remaining.erase(index_of_piece_to_remove);
-            }
-        }
+        halfmove_clock = 0;
+    }
+    else if (halfmove_clock < 0)
+    {
+        return false;
     }
 
-    // Moving the piece to its new destination
-    this->chess_board[to.rank][to.file] = moving_piece;
-    this->chess_board[from.rank][from.file] = {NONE, WHITE};
+    // The placement lists the ranks from the 8th to the 1st, which is the order of the ranks of chess_board
+    chess_piece new_board[BOARD_SIZE][BOARD_SIZE];
+    int king_count[LAST_COLOR] = {};
+    int rank = 0;
+    int file = 0;
 
-    // Keeping track of  whether the pieces which affect the ability of castling have been moved yet since
-    // the start of the game.
-    if (moving_piece.type == KING)
+    for (int new_rank = 0; new_rank < BOARD_SIZE; new_rank++)
     {
-        if (moving_piece.color == WHITE)
-        {
-            set_white_king_moved(true);
-        }
-        else
+        for (int new_file = 0; new_file < BOARD_SIZE; new_file++)
         {
-            set_black_king_moved(true);
+            new_board[new_rank][new_file] = {NONE, WHITE};
         }
     }
-    else if (moving_piece.type == ROOK)
+
+    for (char symbol : placement)
     {
-        if (moving_piece.color == WHITE)
+        if (symbol == '/')
         {
-            if (from.rank == BOARD_SIZE - 1 && from.file == 0)
+            if (file != BOARD_SIZE || ++rank >= BOARD_SIZE)
             {
-                set_white_rook_a_moved(true);
-            }
-            else if (from.rank == BOARD_SIZE - 1 && from.file == BOARD_SIZE - 1)
-            {
-                set_white_rook_h_moved(true);
+                return false;
             }
+
+            file = 0;
+        }
+        else if (symbol >= '1' && symbol <= '8')
+        {
+            file += symbol - '0';
         }
         else
         {
-            if (from.rank == 0 && from.file == 0)
-            {
-                set_black_rook_a_moved(true);
-            }
-            else if (from.rank == 0 && from.file == BOARD_SIZE - 1)
+            size_t type = string("pnbrqk").find((char)tolower(symbol));
+
+            if (type == string::npos || file >= BOARD_SIZE)
             {
-                set_black_rook_h_moved(true);
+                return false;
             }
+
+            piece_color color = isupper(symbol) ? WHITE : BLACK;
+
+            king_count[color] += (type == KING) ? 1 : 0;
+            new_board[rank][file++] = {(piece_type)type, color};
         }
-    }
 
-    // Saving move in move history
-    this->move_history.push(move_data);
-}
+        if (file > BOARD_SIZE)
+        {
+            return false;
+        }
+    }
 
-void board::unmove_piece()
-{
-    if (this->move_history.empty())
+    if (rank != BOARD_SIZE - 1 || file != BOARD_SIZE || king_count[WHITE] != 1 || king_count[BLACK] != 1)
     {
-        return;
+        return false;
     }
 
-    // Get the data about the last move made
-    move_history_data last_move_data = this->move_history.top();
-
-    // Deleting the last move undone from move history
-    move_history.pop();
-    bool moves_history_empty = true;
-    move_history_data previous_previous_move_data = {};
-
-    // Getting the previous move
-    if (!move_history.empty())
+    if (active_color != "w" && active_color != "b")
     {
-        previous_previous_move_data = move_history.top();
-        moves_history_empty = false;
+        return false;
     }
 
-    // Get the last move made
-    move last_move_made = last_move_data.move_made;
-
-    // The moved piece will be the piece at the destination square on the board
-    chess_piece moved_piece = last_move_data.moved_piece;
-
-    // Get the captured piece from the move history data
-    chess_piece captured_piece = last_move_data.piece_captured;
-
-    // Restoring previous castling rights
-    this->set_white_king_moved(last_move_data.prev_white_king_moved);
-    this->set_black_king_moved(last_move_data.prev_black_king_moved);
-    this->set_white_rook_a_moved(last_move_data.prev_white_rook_a_moved);
-    this->set_white_rook_h_moved(last_move_data.prev_white_rook_h_moved);
-    this->set_black_rook_a_moved(last_move_data.prev_black_rook_a_moved);
-    this->set_black_rook_h_moved(last_move_data.prev_black_rook_h_moved);
+    square new_en_passant_target = {-1, -1};
 
-    if (last_move_data.en_passant_capture)
+    if (en_passant != "-")
     {
-        // Move the moved piece back to its original position
-        this->set_piece_at(last_move_made.from, moved_piece);
-        // Since it is an enpassant pawn capture, the destination square should now be empty
-        this->set_piece_at(last_move_made.to, {NONE, WHITE});
+        // The en passant target is behind a pawn which just moved two tiles, so it is on the 6th rank when white is
+        // to move and on the 3rd rank when black is to move
+        char en_passant_rank = (active_color == "w") ? '6' : '3';
 
-        // Used to locate rank of the pawn captured by enpasant
-        int step_rank = 0;
-
-        if (moved_piece.color == WHITE)
+        if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' || en_passant[1] != en_passant_rank)
         {
-            step_rank = 1;
-            // Putting the captured pawn back to black pieces remaining if the moved piece is white
-            this->black_pieces_remaining.push_back(PAWN);
-        }
-        else
-        {
-            step_rank = -1;
-            // Putting the captured pawn back to white pieces remaining if the moved piece is black
-            this->white_pieces_remaining.push_back(PAWN);
+            return false;
         }
 
-        // Get the square where the pawn was captured by enpassant
-        square en_passant_capture_square = {last_move_made.to.rank + step_rank, last_move_made.to.file};
-        // Put the pawn that was captured by enpassant back on the board
-        this->set_piece_at(en_passant_capture_square, {PAWN, (moved_piece.color == WHITE ? BLACK : WHITE)});
+        new_en_passant_target = {BOARD_SIZE - (en_passant[1] - '0'), en_passant[0] - 'a'};
     }
-    else if (last_move_data.king_side_castle)
-    {
-        // Re-positioning the king
-        this->set_piece_at(last_move_made.from, moved_piece);
-        this->set_piece_at(last_move_made.to, {NONE, WHITE});
 
-        // Putting the rook as it was before the king side castle
-        if (moved_piece.color == WHITE)
-        {
-            this->set_piece_at({BOARD_SIZE - 1, BOARD_SIZE - 1}, {ROOK, WHITE});
-            this->set_piece_at({BOARD_SIZE - 1, last_move_made.to.file - 1}, {NONE, WHITE});
-        }
-        else
-        {
-            this->set_piece_at({0, BOARD_SIZE - 1}, {ROOK, BLACK});
-            this->set_piece_at({0, last_move_made.to.file - 1}, {NONE, WHITE});
-        }
-    }
-    else if (last_move_data.queen_side_castle)
-    {
-        // Re-positioning the king
-        this->set_piece_at(last_move_made.from, moved_piece);
-        this->set_piece_at(last_move_made.to, {NONE, WHITE});
+    // The notation is valid, so the board can be replaced
+    this->white_pieces_remaining.clear();
+    this->black_pieces_remaining.clear();
+    this->move_history = {};
+    this->position_key_history.clear();
 
-        // Putting the rook as it was before the queen side castle
-        if (moved_piece.color == WHITE)
-        {
-            this->set_piece_at({BOARD_SIZE - 1, 0}, {ROOK, WHITE});
-            this->set_piece_at({BOARD_SIZE - 1, last_move_made.to.file + 1}, {NONE, WHITE});
-        }
-        else
+    for (rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (file = 0; file < BOARD_SIZE; file++)
         {
-            this->set_piece_at({0, 0}, {ROOK, BLACK});
-            this->set_piece_at({0, last_move_made.to.file + 1}, {NONE, WHITE});
+            chess_piece piece = new_board[rank][file];
+            this->chess_board[rank][file] = piece;
+
+            if (piece.type != NONE)
+            {
+                (piece.color == WHITE ? this->white_pieces_remaining : this->black_pieces_remaining).push_back(piece.type);
+            }
         }
     }
-    else
-    {
-        // Handling case of a quiet move or normal capture move //
 
-        // Moving the moved piece back to it original position
-        this->set_piece_at(last_move_made.from, moved_piece);
-        // Set any piece captured back on the board
-        this->set_piece_at(last_move_made.to, captured_piece);
+    // A king or rook which lost its castling rights is treated as if it moved
+    bool white_king_side = castling.find('K') != string::npos;
+    bool white_queen_side = castling.find('Q') != string::npos;
+    bool black_king_side = castling.find('k') != string::npos;
+    bool black_queen_side = castling.find('q') != string::npos;
 
-        // Updating white_pieces_remaining and black_pieces_remaining accordingly
-        if (captured_piece.type != NONE)
+    this->white_king_moved = !white_king_side && !white_queen_side;
+    this->white_rook_h_moved = !white_king_side;
+    this->white_rook_a_moved = !white_queen_side;
+    this->black_king_moved = !black_king_side && !black_queen_side;
+    this->black_rook_h_moved = !black_king_side;
+    this->black_rook_a_moved = !black_queen_side;
+
+    this->side_to_move = (active_color == "w") ? WHITE : BLACK;
+    this->halfmove_clock = halfmove_clock;
+    this->en_passant_target = new_en_passant_target;
+
+    this->initialize_incremental_state();
+
+    return true;
+}
+
+bool board::verify_incremental_state() const
+{
+    uint8_t piece_codes[BOARD_SIZE * BOARD_SIZE];
+    int phase_weight = 0;
+    bool bitboards_match = true;
+
+    this->get_piece_codes(piece_codes);
+
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        uint64_t color_bitboard = 0;
+
+        for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
         {
-            if (captured_piece.color == WHITE)
-            {
-                this->white_pieces_remaining.push_back(captured_piece.type);
-            }
-            else
+            uint64_t piece_bitboard = 0;
+
+            for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile++)
             {
-                this->black_pieces_remaining.push_back(captured_piece.type);
+                if (piece_codes[tile] == piece_code({(piece_type)type, (piece_color)color}))
+                {
+                    piece_bitboard |= 1ULL << tile;
+                    phase_weight += PIECE_PHASE_WEIGHT[type];
+                }
             }
+
+            bitboards_match = bitboards_match && piece_bitboard == this->piece_bitboards[color][type];
+            color_bitboard |= piece_bitboard;
         }
+
+        bitboards_match = bitboards_match && color_bitboard == this->color_bitboards[color];
     }
 
-    // Basically, the first move made in the game cannot have a non-empty move history
-    if (!moves_history_empty)
+    return bitboards_match && this->position_key == this->compute_position_key() && this->pawn_key == this->compute_pawn_key() &&
+           this->material_signature == this->compute_material_signature() && this->phase_weight == phase_weight &&
+           this->piece_square_score == piece_square_rescan(piece_codes);
+}
+
+uint64_t board::compute_position_key() const
+{
+    uint64_t key = 0;
+
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
     {
-        if (previous_previous_move_data.en_passant_opportunity)
+        for (int file = 0; file < BOARD_SIZE; file++)
         {
-            // Recreating en passant target if the last moved was an enpassant but not enpassant capture was made
-            this->set_en_passant_target(previous_previous_move_data.en_passant_opportunity_square);
+            key ^= piece_key(this->chess_board[rank][file], {rank, file});
         }
     }
-    else
+
+    key ^= ZOBRIST.castling[this->castling_flags()];
+
+    if (this->en_passant_target.file != -1)
     {
-        // Resetting enpassant target
-        this->reset_en_passant_target();
+        key ^= ZOBRIST.en_passant_file[this->en_passant_target.file];
+    }
+
+    if (this->side_to_move == BLACK)
+    {
+        key ^= ZOBRIST.black_to_move;
     }
+
+    return key;
 }
 
-bool board::is_square_attacked(square tile, piece_color attacker_color) const
+uint64_t board::compute_pawn_key() const
 {
-    move possible_attack_move;
+    uint64_t key = 0;
 
-    // Looping through every tile and if it contains a piece of our specified color,
-    // check whether that piece can attack the given square. If there is at least one, return true/
     for (int rank = 0; rank < BOARD_SIZE; rank++)
     {
         for (int file = 0; file < BOARD_SIZE; file++)
         {
-            chess_piece piece = chess_board[rank][file];
-
-            if (piece.type != NONE && piece.color == attacker_color)
+            if (this->chess_board[rank][file].type == PAWN)
             {
-                possible_attack_move.from = {rank, file};
-                possible_attack_move.to = tile;
-
-                if (is_legal_move(*this, possible_attack_move, true))
-                {
-                    return true;
-                }
+                key ^= piece_key(this->chess_board[rank][file], {rank, file});
             }
         }
     }
 
-    return false;
+    return key;
 }
 
-square board::find_the_king(piece_color king_color) const
+uint64_t board::compute_material_signature() const
 {
-    // Loop through every tile till we come across our king of the given color
+    uint64_t signature = 0;
+
     for (int rank = 0; rank < BOARD_SIZE; rank++)
     {
         for (int file = 0; file < BOARD_SIZE; file++)
         {
             chess_piece piece = this->chess_board[rank][file];
 
-            if (piece.type == KING && piece.color == king_color)
+            if (piece.type != NONE)
             {
-                return {rank, file};
+                signature += material_signature_unit(piece.color, piece.type);
             }
         }
     }
 
-    return {-1, -1};
+    return signature;
 }
 
-bool board::king_in_check(piece_color king_color) const
+int board::castling_flags() const
 {
-    square king_square = this->find_the_king(king_color);
-    piece_color opponent_color;
+    return (this->white_king_moved ? 1 : 0) | (this->black_king_moved ? 2 : 0) | (this->white_rook_a_moved ? 4 : 0) |
+           (this->white_rook_h_moved ? 8 : 0) | (this->black_rook_a_moved ? 16 : 0) | (this->black_rook_h_moved ? 32 : 0);
+}
 
-    // Error checking
-    if (king_square.rank == -1 || king_square.file == -1)
-    {
-        return false;
-    }
+piece_color board::get_side_to_move() const
+{
+    return this->side_to_move;
+}
 
-    // Getting the color of this king's opponent
-    if (king_color == WHITE)
-    {
-        opponent_color = BLACK;
-    }
-    else
-    {
-        opponent_color = WHITE;
-    }
+int board::get_halfmove_clock() const
+{
+    return this->halfmove_clock;
+}
 
-    // If king is being attacked, it is in check
-    return is_square_attacked(king_square, opponent_color);
+uint64_t board::get_position_key() const
+{
+    return this->position_key;
 }
 
-void board::set_white_king_moved(bool truth)
+uint64_t board::get_pawn_key() const
 {
-    this->white_king_moved = truth;
+    return this->pawn_key;
 }
 
-bool board::get_white_king_moved() const
+uint64_t board::get_piece_bitboard(piece_color color, piece_type type) const
 {
-    return this->white_king_moved;
+    return this->piece_bitboards[color][type];
 }
 
-void board::set_black_king_moved(bool truth)
+uint64_t board::get_color_bitboard(piece_color color) const
 {
-    this->black_king_moved = truth;
+    return this->color_bitboards[color];
 }
 
-bool board::get_black_king_moved() const
+uint64_t board::get_material_signature() const
 {
-    return this->black_king_moved;
+    return this->material_signature;
 }
 
-void board::set_white_rook_a_moved(bool truth)
+int board::get_piece_square_score() const
 {
-    this->white_rook_a_moved = truth;
+    return this->piece_square_score;
 }
 
-bool board::get_white_rook_a_moved() const
+int board::get_phase_weight() const
 {
-    return this->white_rook_a_moved;
+    return this->phase_weight;
 }
 
-void board::set_white_rook_h_moved(bool truth)
+int board::get_piece_count(piece_color color, piece_type type) const
 {
-    this->white_rook_h_moved = truth;
+    return (this->material_signature / material_signature_unit(color, type)) & ((1 << MATERIAL_SIGNATURE_BITS) - 1);
 }
 
-bool board::get_white_rook_h_moved() const
+int board::repetition_count() const
 {
-    return this->white_rook_h_moved;
+    int count = 0;
+    int history_size = this->position_key_history.size();
+
+    // Only positions with the same player to move and played since the last capture or pawn move
+    // can be repetitions of the current one
+    for (int index = history_size - 2; index >= 0 && index >= history_size - this->halfmove_clock; index -= 2)
+    {
+        if (this->position_key_history[index] == this->position_key)
+        {
+            count++;
+        }
+    }
+
+    return count;
 }
 
-void board::set_black_rook_a_moved(bool truth)
+void board::set_en_passant_target(const square potential_en_passant_target)
 {
-    this->black_rook_a_moved = truth;
+    this->en_passant_target = potential_en_passant_target;
 }
 
-bool board::get_black_rook_a_moved() const
+square board::get_en_passant_target() const
 {
-    return this->black_rook_a_moved;
+    return this->en_passant_target;
 }
 
-void board::set_black_rook_h_moved(bool truth)
+void board::reset_en_passant_target()
 {
-    this->black_rook_h_moved = truth;
+    this->en_passant_target = {-1, -1};
 }
 
-bool board::get_black_rook_h_moved() const
+chess_piece board::get_piece_at(int rank, int file) const
 {
-    return this->black_rook_h_moved;
+    return this->chess_board[rank][file];
 }
 
-bool board::checkmate_or_stalemate(piece_color king_color, bool check_stalemate)
+void board::set_piece_at(square tile, chess_piece piece)
 {
+    chess_piece old_piece = this->chess_board[tile.rank][tile.file];
 
-    // king_in_check XOR check_stalemate :)
-    if (!this->king_in_check(king_color) && !check_stalemate)
+    // Keeping the position key up to date by removing the piece which was on the tile and adding the new one
+    this->position_key ^= piece_key(old_piece, tile) ^ piece_key(piece, tile);
+
+    // The pawn key only changes when a pawn is placed or removed
+    if (old_piece.type == PAWN)
     {
-        return false;
+        this->pawn_key ^= piece_key(old_piece, tile);
     }
-    else if (this->king_in_check(king_color) && check_stalemate)
+
+    if (piece.type == PAWN)
     {
-        return false;
+        this->pawn_key ^= piece_key(piece, tile);
     }
 
-    // Get all legal moves that can be played by the player for whom we are checking for checkmate/stalemate
-    vector<move> legal_moves = generate_legal_moves(*this, king_color);
+    // Keeping the material signature up to date in the same way
+    if (old_piece.type != NONE)
+    {
+        this->material_signature -= material_signature_unit(old_piece.color, old_piece.type);
+    }
 
-    // If a legal move can be played, the position cannot be a checkmate/stalemate
-    if (legal_moves.size() != 0)
+    if (piece.type != NONE)
     {
-        return false;
+        this->material_signature += material_signature_unit(piece.color, piece.type);
     }
 
-    return true;
+    // Keeping the piece square score and phase weight up to date
+    this->update_evaluation_terms(old_piece, tile, -1);
+    this->update_evaluation_terms(piece, tile, 1);
+
+    // Keeping the bitboards up to date
+    this->toggle_piece_bitboards(old_piece, tile);
+    this->toggle_piece_bitboards(piece, tile);
+
+    // Keeping the accumulators of the neural network up to date
+    this->update_accumulator(old_piece, tile, false);
+    this->update_accumulator(piece, tile, true);
+
+    this->chess_board[tile.rank][tile.file] = piece;
 }
 
-string SDLStructures::get_piece_file_name(piece_color color, piece_type type)
+void board::update_evaluation_terms(const chess_piece &piece, const square &tile, const int sign)
 {
-    // Exiting the method if an empty tile has been passed
-    if (type == NONE)
+    if (piece.type == NONE)
     {
-        return "";
+        return;
     }
 
-    // Use of ternary operator here. Getting the color of the piece as a string
-    string colorStr = (color == WHITE) ? "White" : "Black";
-    string typeStr = "";
-    string path = "";
+    // Scores of black pieces are already negative, so the score of the piece is simply added or removed
+    this->piece_square_score += sign * piece_square_value(piece, tile);
+    this->phase_weight += sign * PIECE_PHASE_WEIGHT[piece.type];
+}
 
-    // DO NOT CHANGE THE STRING AS IT FOLLOWS THE NAMING CONVENTIONS I USED FOR MY PNG FILES
-    // Getting the type of the piece as a string
-    switch (type)
+void board::toggle_piece_bitboards(const chess_piece &piece, const square &tile)
+{
+    if (piece.type == NONE)
     {
-    case PAWN:
-        typeStr = "Pawn";
-        break;
-    case KNIGHT:
-        typeStr = "Knight";
-        break;
-    case BISHOP:
-        typeStr = "Bishop";
-        break;
-    case ROOK:
-        typeStr = "Rook";
-        break;
-    case QUEEN:
-        typeStr = "Queen";
-        break;
-    case KING:
-        typeStr = "King";
-        break;
-    default:
-        return "";
+        return;
     }
 
-    // Creating the file path where the png image for the chess piece if found
-    path = format("assets/pieces/{}_{}.png", colorStr, typeStr);
-    return path;
+    uint64_t tile_bit = 1ULL << (tile.rank * BOARD_SIZE + tile.file);
+
+    this->piece_bitboards[piece.color][piece.type] ^= tile_bit;
+    this->color_bitboards[piece.color] ^= tile_bit;
 }
 
-bool SDLStructures::load_piece_textures()
+void board::update_accumulator(const chess_piece &piece, const square &tile, const bool placed)
 {
-    // Getting the texture of every piece.
-    for (int piece_color_value = FIRST_COLOR; piece_color_value < LAST_COLOR; piece_color_value++)
+    if (piece.type == NONE)
     {
-        for (int piece_type_value = FIRST_TYPE; piece_type_value < LAST_TYPE; piece_type_value++)
-        {
-            // Getting the color of the current piece
-            piece_color color_of_piece = static_cast<piece_color>(piece_color_value);
-            // Getting the type of the current piece
-            piece_type type_of_piece = static_cast<piece_type>(piece_type_value);
+        return;
+    }
 
-            // Getting the file path of where the png image for that chess piece is found
-            string file_path = get_piece_file_name(color_of_piece, type_of_piece);
+    // While the classic evaluator is used, the accumulators are not updated. They are computed from scratch if the
+    // neural network is chosen again
+    if (get_evaluator() != NNUE_EVALUATOR)
+    {
+        this->accumulator.computed[WHITE] = this->accumulator.computed[BLACK] = false;
+        return;
+    }
 
-            // Converting the string to a C style string as SDL works with const char *
-            //, not with string data type
-            const char *path = file_path.c_str();
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        piece_color perspective = (piece_color)color;
 
-            // Initailizing the surface for the image so that we can manipulate it
-            SDL_Surface *surf = IMG_Load(path);
+        if (!this->accumulator.computed[perspective])
+        {
+            continue;
+        }
 
-            // Checks if surf is nullptr, because if it is it means we failed to load the image
-            if (!surf)
+        // Every input of a perspective depends on the tile of its king. Kings themselves are not inputs
+        if (piece.type == KING)
+        {
+            if (piece.color == perspective)
             {
-                // Print the error message to the console
-                SDL_Log("Failed to load %s: %s", path, SDL_GetError());
-                return false;
+                this->accumulator.computed[perspective] = false;
             }
 
-            this->piece_textures[piece_color_value][piece_type_value] = SDL_CreateTextureFromSurface(this->renderer, surf);
+            continue;
+        }
 
-            // Since we already stored the surface in our array, we destroy it
-            SDL_DestroySurface(surf);
-            // Checks for nullptr, as this means we failed to create the texture
-            if (!this->piece_textures[piece_color_value][piece_type_value])
-            {
-                SDL_Log("Failed to create texture for %s: %s", path, SDL_GetError());
-                return false;
-            }
+        int king_tile = countr_zero(this->piece_bitboards[perspective][KING]);
+        int input = nnue_input_index(perspective, king_tile, piece, tile.rank * BOARD_SIZE + tile.file);
+
+        if (placed)
+        {
+            nnue_add_input(this->accumulator.values[perspective], input);
+        }
+        else
+        {
+            nnue_remove_input(this->accumulator.values[perspective], input);
         }
     }
-    return true;
 }
 
-bool valid_move_simulated(board &temp_board, const move current_move, bool valid_move)
+const nnue_accumulator &board::get_accumulator()
 {
-    // If the move played on the piece is already detected to be an illegal one,
-    // return false
-    if (!valid_move)
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
     {
-        return false;
-    }
+        piece_color perspective = (piece_color)color;
 
-    // Try to play the move on a copy of the board
-    temp_board.move_piece(current_move);
+        if (this->accumulator.computed[perspective])
+        {
+            continue;
+        }
 
-    chess_piece moving_piece = temp_board.get_piece_at(current_move.to.rank, current_move.to.file);
+        int king_tile = countr_zero(this->piece_bitboards[perspective][KING]);
+        uint64_t pieces = (this->color_bitboards[WHITE] | this->color_bitboards[BLACK]) &
+                          ~(this->piece_bitboards[WHITE][KING] | this->piece_bitboards[BLACK][KING]);
 
-    // If when the move is played, the king of the same colour is in check, this means that this move cannot be played.
-    // This pins a piece which is blocking an attack on the king and prevents the player from playing a
-    // move that does not remove his king from check, if his king is in check
-    if (temp_board.king_in_check(moving_piece.color))
-    {
-        return false;
+        nnue_reset_accumulator(this->accumulator.values[perspective]);
+
+        while (pieces)
+        {
+            int tile = countr_zero(pieces);
+            pieces &= pieces - 1;
+
+            chess_piece piece = this->chess_board[tile / BOARD_SIZE][tile % BOARD_SIZE];
+            nnue_add_input(this->accumulator.values[perspective], nnue_input_index(perspective, king_tile, piece, tile));
+        }
+
+        this->accumulator.computed[perspective] = true;
     }
 
-    return true;
+    return this->accumulator;
 }
 
-bool is_legal_move(const board &the_board, const move &current_move, bool consider_attacks_only)
+void board::move_piece(const move &current_move)
 {
-    // Getting the chess piece selected
-    chess_piece piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
-
-    // User selected an empty tile
-    if (piece.type == NONE)
-    {
-        return false;
-    }
+    square from = current_move.from;
+    square to = current_move.to;
+    move_history_data move_data;
+    chess_piece moving_piece = this->get_piece_at(from.rank, from.file);
+    chess_piece captured_piece = this->get_piece_at(to.rank, to.file);
 
-    // Calculating the displacement of the piece by the move made in terms of the rank displacement and file displacement
-    int rank_displacement = current_move.to.rank - current_move.from.rank;
-    int file_displacement = current_move.to.file - current_move.from.file;
+    // Updating the move history
+    move_data.move_made = current_move;
+    move_data.moved_piece = moving_piece;
+    move_data.king_side_castle = false;
+    move_data.queen_side_castle = false;
+    move_data.en_passant_capture = false;
+    move_data.en_passant_opportunity = false;
+    move_data.en_passant_opportunity_square = {-1, -1};
+    move_data.prev_white_king_moved = this->get_white_king_moved();
+    move_data.prev_black_king_moved = this->get_black_king_moved();
+    move_data.prev_white_rook_a_moved = this->get_white_rook_a_moved();
+    move_data.prev_white_rook_h_moved = this->get_white_rook_h_moved();
+    move_data.prev_black_rook_a_moved = this->get_black_rook_a_moved();
+    move_data.prev_black_rook_h_moved = this->get_black_rook_h_moved();
+    move_data.prev_position_key = this->position_key;
+    move_data.prev_halfmove_clock = this->halfmove_clock;
+    move_data.prev_en_passant_target = this->en_passant_target;
 
-    // When user has double clicked on a piece, we just ignore it
-    if (rank_displacement == 0 && file_displacement == 0)
-    {
-        return false;
-    }
+    // Remembering the position for repetition detection
+    this->position_key_history.push_back(this->position_key);
 
-    // Getting the piece at the destination of the move made
-    chess_piece target = the_board.get_piece_at(current_move.to.rank, current_move.to.file);
+    // Removing the castling flags and en passant target from the position key. They are added back
+    // once the move has been made, as the move may change them
+    this->position_key ^= ZOBRIST.castling[this->castling_flags()];
 
-    // If the target tile contains a piece of the same color, this is an illegal move
-    // as we cannot capture our own pieces
-    if (target.type != NONE && target.color == piece.color)
+    if (this->en_passant_target.file != -1)
     {
-        return false;
+        this->position_key ^= ZOBRIST.en_passant_file[this->en_passant_target.file];
     }
 
-    // White pieces  move up while black pieces usually move down according to our board convention
-    int direction = (piece.color == WHITE) ? -1 : 1;
-
-    // Flag to know if the move played follows how pieces move according to chess rules
-    bool legal_move_played = false;
-    // Flag used to keep track if a castling attempt is illegal
-    bool improper_castle = false;
+    // Difference in rank of the piece position caused by the move
+    int rank_difference = to.rank - from.rank;
+    // Difference in file of the piece position caused by the move
+    int file_difference = to.file - from.file;
 
-    // Checking if move made is legal based on the type of the piece
-    switch (piece.type)
+    // Checking for castling move
+    if (moving_piece.type == KING && abs(file_difference) == 2)
     {
-    case PAWN:
-        if (!consider_attacks_only)
+        if (to.file == 6) // Kingside castling
         {
-            // If pawn moved by 1 rank in its allowed direction, it is acceptable
+            move_data.king_side_castle = true;
+            // Moving the h file rook for the king side castle
+            this->set_piece_at({from.rank, 5}, this->chess_board[from.rank][BOARD_SIZE - 1]);
+            this->set_piece_at({from.rank, BOARD_SIZE - 1}, {NONE, WHITE});
+        }
+        else if (to.file == 2) // Queen side castling
+        {
+            move_data.queen_side_castle = true;
+            // Moving the a file rook for the queen side castle
+            this->set_piece_at({from.rank, 3}, this->chess_board[from.rank][0]);
+            this->set_piece_at({from.rank, 0}, {NONE, WHITE});
+        }
+    }
+
+    if (moving_piece.type == PAWN)
+    {
+        square potential_en_passant_target = this->get_en_passant_target();
+        // Checking if it is a valid en passant capture attempt
+        if (potential_en_passant_target.rank == to.rank && potential_en_passant_target.file == to.file && abs(file_difference) == 1 && this->chess_board[to.rank][to.file].type == NONE)
+        {
+            // The rank of the pawn which we are trying to capture by en passant
+            int captured_pawn_rank;
+
+            // Getting the rank of the pawn which we are trying to capture by en passant, based on the piece color
+            if (moving_piece.color == WHITE)
+            {
+                captured_pawn_rank = to.rank + 1; // Add one as black pawns move in +1 steps
+            }
+            else
+            {
+                captured_pawn_rank = to.rank - 1; // Minus one as white pawns move in -1 steps
+            }
+
+            // Chess piece being captured
+            chess_piece potential_pawn_capture = this->chess_board[captured_pawn_rank][to.file];
+
+            // Must check if it is a pawn of the opposite color before capturing it
+            if (potential_pawn_capture.type == PAWN && potential_pawn_capture.color != moving_piece.color)
+            {
+                captured_piece = this->chess_board[captured_pawn_rank][to.file];
+                // Removing the captured pawn from the board
+                this->set_piece_at({captured_pawn_rank, to.file}, {NONE, WHITE});
+                // Setting en passant capture flag to true
+                move_data.en_passant_capture = true;
+            }
+        }
+
+        // If the pawn we have moved, has moved by 2 ranks, it is a potential en passant capture
+        if (abs(rank_difference) == 2)
+        {
+            int en_passant_rank = (from.rank + to.rank) / 2;                        // Getting the rank of the en passant target, if it is captured
+            this->set_en_passant_target({en_passant_rank, from.file});              // Creating the en passant target
+            move_data.en_passant_opportunity = true;                                // Creating en-passant capture opportunity for this move in move history
+            move_data.en_passant_opportunity_square = {en_passant_rank, from.file}; // Getting the en passant target for this en passant opportunity
+        }
+    }
+
+    // If we did not move a pawn by 2 ranks this move, it means there is no en passant target for the next move
+    if (!(moving_piece.type == PAWN && abs(rank_difference) == 2))
+    {
+        this->reset_en_passant_target();
+    }
+
+    // Recording piece capture in move_data
+    move_data.piece_captured = captured_piece;
+
+    // Updating the vectors keeping track of the number of pieces on the board
+    if (captured_piece.color != moving_piece.color && captured_piece.type != NONE)
+    {
+        if (captured_piece.color == WHITE)
+        {
+            // The data type of index_of_piece_to_remove will be generated dynamically
+            auto index_of_piece_to_remove = find(this->white_pieces_remaining.begin(), this->white_pieces_remaining.end(), captured_piece.type);
+
+            // Checking if the piece has been found first
+            if (index_of_piece_to_remove != this->white_pieces_remaining.end())
+            {
+                this->white_pieces_remaining.erase(index_of_piece_to_remove);
+            }
+        }
+        else
+        {
+            // The data type of index_of_piece_to_remove will be generated dynamically
+            auto index_of_piece_to_remove = find(this->black_pieces_remaining.begin(), this->black_pieces_remaining.end(), captured_piece.type);
+
+            // Checking if the piece has been found first
+            if (index_of_piece_to_remove != this->black_pieces_remaining.end())
+            {
+                this->black_pieces_remaining.erase(index_of_piece_to_remove);
+            }
+        }
+    }
+
+    // Moving the piece to its new destination
+    this->set_piece_at(to, moving_piece);
+    this->set_piece_at(from, {NONE, WHITE});
+
+    // Keeping track of  whether the pieces which affect the ability of castling have been moved yet since
+    // the start of the game.
+    if (moving_piece.type == KING)
+    {
+        if (moving_piece.color == WHITE)
+        {
+            set_white_king_moved(true);
+        }
+        else
+        {
+            set_black_king_moved(true);
+        }
+    }
+    else if (moving_piece.type == ROOK)
+    {
+        if (moving_piece.color == WHITE)
+        {
+            if (from.rank == BOARD_SIZE - 1 && from.file == 0)
+            {
+                set_white_rook_a_moved(true);
+            }
+            else if (from.rank == BOARD_SIZE - 1 && from.file == BOARD_SIZE - 1)
+            {
+                set_white_rook_h_moved(true);
+            }
+        }
+        else
+        {
+            if (from.rank == 0 && from.file == 0)
+            {
+                set_black_rook_a_moved(true);
+            }
+            else if (from.rank == 0 && from.file == BOARD_SIZE - 1)
+            {
+                set_black_rook_h_moved(true);
+            }
+        }
+    }
+
+    // The fifty-move rule counter starts again after a capture or a pawn move
+    if (moving_piece.type == PAWN || captured_piece.type != NONE)
+    {
+        this->halfmove_clock = 0;
+    }
+    else
+    {
+        this->halfmove_clock++;
+    }
+
+    // It is now the other player's turn
+    this->side_to_move = (this->side_to_move == WHITE) ? BLACK : WHITE;
+
+    // Adding the new castling flags, en passant target and player to move to the position key
+    this->position_key ^= ZOBRIST.castling[this->castling_flags()] ^ ZOBRIST.black_to_move;
+
+    if (this->en_passant_target.file != -1)
+    {
+        this->position_key ^= ZOBRIST.en_passant_file[this->en_passant_target.file];
+    }
+
+    // Saving move in move history
+    this->move_history.push(move_data);
+}
+
+void board::unmove_piece()
+{
+    if (this->move_history.empty())
+    {
+        return;
+    }
+
+    // Get the data about the last move made
+    move_history_data last_move_data = this->move_history.top();
+
+    // Deleting the last move undone from move history
+    move_history.pop();
+
+    // Get the last move made
+    move last_move_made = last_move_data.move_made;
+
+    // The moved piece will be the piece at the destination square on the board
+    chess_piece moved_piece = last_move_data.moved_piece;
+
+    // Get the captured piece from the move history data
+    chess_piece captured_piece = last_move_data.piece_captured;
+
+    // Restoring previous castling rights
+    this->set_white_king_moved(last_move_data.prev_white_king_moved);
+    this->set_black_king_moved(last_move_data.prev_black_king_moved);
+    this->set_white_rook_a_moved(last_move_data.prev_white_rook_a_moved);
+    this->set_white_rook_h_moved(last_move_data.prev_white_rook_h_moved);
+    this->set_black_rook_a_moved(last_move_data.prev_black_rook_a_moved);
+    this->set_black_rook_h_moved(last_move_data.prev_black_rook_h_moved);
+
+    if (last_move_data.en_passant_capture)
+    {
+        // Move the moved piece back to its original position
+        this->set_piece_at(last_move_made.from, moved_piece);
+        // Since it is an enpassant pawn capture, the destination square should now be empty
+        this->set_piece_at(last_move_made.to, {NONE, WHITE});
+
+        // Used to locate rank of the pawn captured by enpasant
+        int step_rank = 0;
+
+        if (moved_piece.color == WHITE)
+        {
+            step_rank = 1;
+            // Putting the captured pawn back to black pieces remaining if the moved piece is white
+            this->black_pieces_remaining.push_back(PAWN);
+        }
+        else
+        {
+            step_rank = -1;
+            // Putting the captured pawn back to white pieces remaining if the moved piece is black
+            this->white_pieces_remaining.push_back(PAWN);
+        }
+
+        // Get the square where the pawn was captured by enpassant
+        square en_passant_capture_square = {last_move_made.to.rank + step_rank, last_move_made.to.file};
+        // Put the pawn that was captured by enpassant back on the board
+        this->set_piece_at(en_passant_capture_square, {PAWN, (moved_piece.color == WHITE ? BLACK : WHITE)});
+    }
+    else if (last_move_data.king_side_castle)
+    {
+        // Re-positioning the king
+        this->set_piece_at(last_move_made.from, moved_piece);
+        this->set_piece_at(last_move_made.to, {NONE, WHITE});
+
+        // Putting the rook as it was before the king side castle
+        if (moved_piece.color == WHITE)
+        {
+            this->set_piece_at({BOARD_SIZE - 1, BOARD_SIZE - 1}, {ROOK, WHITE});
+            this->set_piece_at({BOARD_SIZE - 1, last_move_made.to.file - 1}, {NONE, WHITE});
+        }
+        else
+        {
+            this->set_piece_at({0, BOARD_SIZE - 1}, {ROOK, BLACK});
+            this->set_piece_at({0, last_move_made.to.file - 1}, {NONE, WHITE});
+        }
+    }
+    else if (last_move_data.queen_side_castle)
+    {
+        // Re-positioning the king
+        this->set_piece_at(last_move_made.from, moved_piece);
+        this->set_piece_at(last_move_made.to, {NONE, WHITE});
+
+        // Putting the rook as it was before the queen side castle
+        if (moved_piece.color == WHITE)
+        {
+            this->set_piece_at({BOARD_SIZE - 1, 0}, {ROOK, WHITE});
+            this->set_piece_at({BOARD_SIZE - 1, last_move_made.to.file + 1}, {NONE, WHITE});
+        }
+        else
+        {
+            this->set_piece_at({0, 0}, {ROOK, BLACK});
+            this->set_piece_at({0, last_move_made.to.file + 1}, {NONE, WHITE});
+        }
+    }
+    else
+    {
+        // Handling case of a quiet move or normal capture move //
+
+        // Moving the moved piece back to it original position
+        this->set_piece_at(last_move_made.from, moved_piece);
+        // Set any piece captured back on the board
+        this->set_piece_at(last_move_made.to, captured_piece);
+
+        // Updating white_pieces_remaining and black_pieces_remaining accordingly
+        if (captured_piece.type != NONE)
+        {
+            if (captured_piece.color == WHITE)
+            {
+                this->white_pieces_remaining.push_back(captured_piece.type);
+            }
+            else
+            {
+                this->black_pieces_remaining.push_back(captured_piece.type);
+            }
+        }
+    }
+
+    // Restoring the en passant target, which may also come from a position set up with load_fen
+    this->en_passant_target = last_move_data.prev_en_passant_target;
+
+    // Restoring the player to move, the fifty-move rule counter and the position key
+    this->side_to_move = (this->side_to_move == WHITE) ? BLACK : WHITE;
+    this->halfmove_clock = last_move_data.prev_halfmove_clock;
+    this->position_key = last_move_data.prev_position_key;
+    this->position_key_history.pop_back();
+}
+
+bool board::is_square_attacked(square tile, piece_color attacker_color) const
+{
+    move possible_attack_move;
+
+    // Looping through every tile and if it contains a piece of our specified color,
+    // check whether that piece can attack the given square. If there is at least one, return true/
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            chess_piece piece = chess_board[rank][file];
+
+            if (piece.type != NONE && piece.color == attacker_color)
+            {
+                possible_attack_move.from = {rank, file};
+                possible_attack_move.to = tile;
+
+                if (is_legal_move(*this, possible_attack_move, true))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+square board::find_the_king(piece_color king_color) const
+{
+    // Loop through every tile till we come across our king of the given color
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            chess_piece piece = this->chess_board[rank][file];
+
+            if (piece.type == KING && piece.color == king_color)
+            {
+                return {rank, file};
+            }
+        }
+    }
+
+    return {-1, -1};
+}
+
+bool board::king_in_check(piece_color king_color) const
+{
+    square king_square = this->find_the_king(king_color);
+    piece_color opponent_color;
+
+    // Error checking
+    if (king_square.rank == -1 || king_square.file == -1)
+    {
+        return false;
+    }
+
+    // Getting the color of this king's opponent
+    if (king_color == WHITE)
+    {
+        opponent_color = BLACK;
+    }
+    else
+    {
+        opponent_color = WHITE;
+    }
+
+    // If king is being attacked, it is in check
+    return is_square_attacked(king_square, opponent_color);
+}
+
+void board::set_white_king_moved(bool truth)
+{
+    this->white_king_moved = truth;
+}
+
+bool board::get_white_king_moved() const
+{
+    return this->white_king_moved;
+}
+
+void board::set_black_king_moved(bool truth)
+{
+    this->black_king_moved = truth;
+}
+
+bool board::get_black_king_moved() const
+{
+    return this->black_king_moved;
+}
+
+void board::set_white_rook_a_moved(bool truth)
+{
+    this->white_rook_a_moved = truth;
+}
+
+bool board::get_white_rook_a_moved() const
+{
+    return this->white_rook_a_moved;
+}
+
+void board::set_white_rook_h_moved(bool truth)
+{
+    this->white_rook_h_moved = truth;
+}
+
+bool board::get_white_rook_h_moved() const
+{
+    return this->white_rook_h_moved;
+}
+
+void board::set_black_rook_a_moved(bool truth)
+{
+    this->black_rook_a_moved = truth;
+}
+
+bool board::get_black_rook_a_moved() const
+{
+    return this->black_rook_a_moved;
+}
+
+void board::set_black_rook_h_moved(bool truth)
+{
+    this->black_rook_h_moved = truth;
+}
+
+bool board::get_black_rook_h_moved() const
+{
+    return this->black_rook_h_moved;
+}
+
+bool board::checkmate_or_stalemate(piece_color king_color, bool check_stalemate)
+{
+    bool in_check = this->king_in_check(king_color);
+
+    // king_in_check XOR check_stalemate :)
+    if (in_check == check_stalemate)
+    {
+        return false;
+    }
+
+    // If a legal move can be played, the position cannot be a checkmate/stalemate
+    return !has_legal_move(*this, king_color);
+}
+
+string SDLStructures::get_piece_file_name(piece_color color, piece_type type)
+{
+    // Exiting the method if an empty tile has been passed
+    if (type == NONE)
+    {
+        return "";
+    }
+
+    // Use of ternary operator here. Getting the color of the piece as a string
+    string colorStr = (color == WHITE) ? "White" : "Black";
+    string typeStr = "";
+    string path = "";
+
+    // DO NOT CHANGE THE STRING AS IT FOLLOWS THE NAMING CONVENTIONS I USED FOR MY PNG FILES
+    // Getting the type of the piece as a string
+    switch (type)
+    {
+    case PAWN:
+        typeStr = "Pawn";
+        break;
+    case KNIGHT:
+        typeStr = "Knight";
+        break;
+    case BISHOP:
+        typeStr = "Bishop";
+        break;
+    case ROOK:
+        typeStr = "Rook";
+        break;
+    case QUEEN:
+        typeStr = "Queen";
+        break;
+    case KING:
+        typeStr = "King";
+        break;
+    default:
+        return "";
+    }
+
+    // Creating the file path where the png image for the chess piece if found
+    path = format("assets/pieces/{}_{}.png", colorStr, typeStr);
+    return path;
+}
+
+bool SDLStructures::load_piece_textures()
+{
+    // Getting the texture of every piece.
+    for (int piece_color_value = FIRST_COLOR; piece_color_value < LAST_COLOR; piece_color_value++)
+    {
+        for (int piece_type_value = FIRST_TYPE; piece_type_value < LAST_TYPE; piece_type_value++)
+        {
+            // Getting the color of the current piece
+            piece_color color_of_piece = static_cast<piece_color>(piece_color_value);
+            // Getting the type of the current piece
+            piece_type type_of_piece = static_cast<piece_type>(piece_type_value);
+
+            // Getting the file path of where the png image for that chess piece is found
+            string file_path = get_piece_file_name(color_of_piece, type_of_piece);
+
+            // Converting the string to a C style string as SDL works with const char *
+            //, not with string data type
+            const char *path = file_path.c_str();
+
+            // Initailizing the surface for the image so that we can manipulate it
+            SDL_Surface *surf = IMG_Load(path);
+
+            // Checks if surf is nullptr, because if it is it means we failed to load the image
+            if (!surf)
+            {
+                // Print the error message to the console
+                SDL_Log("Failed to load %s: %s", path, SDL_GetError());
+                return false;
+            }
+
+            this->piece_textures[piece_color_value][piece_type_value] = SDL_CreateTextureFromSurface(this->renderer, surf);
+
+            // Since we already stored the surface in our array, we destroy it
+            SDL_DestroySurface(surf);
+            // Checks for nullptr, as this means we failed to create the texture
+            if (!this->piece_textures[piece_color_value][piece_type_value])
+            {
+                SDL_Log("Failed to create texture for %s: %s", path, SDL_GetError());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool valid_move_simulated(board &temp_board, const move current_move, bool valid_move)
+{
+    // If the move played on the piece is already detected to be an illegal one,
+    // return false
+    if (!valid_move)
+    {
+        return false;
+    }
+
+    // Try to play the move on a copy of the board
+    temp_board.move_piece(current_move);
+
+    chess_piece moving_piece = temp_board.get_piece_at(current_move.to.rank, current_move.to.file);
+
+    // If when the move is played, the king of the same colour is in check, this means that this move cannot be played.
+    // This pins a piece which is blocking an attack on the king and prevents the player from playing a
+    // move that does not remove his king from check, if his king is in check
+    if (temp_board.king_in_check(moving_piece.color))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool is_legal_move(const board &the_board, const move &current_move, bool consider_attacks_only)
+{
+    // Getting the chess piece selected
+    chess_piece piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
+
+    // User selected an empty tile
+    if (piece.type == NONE)
+    {
+        return false;
+    }
+
+    // Calculating the displacement of the piece by the move made in terms of the rank displacement and file displacement
+    int rank_displacement = current_move.to.rank - current_move.from.rank;
+    int file_displacement = current_move.to.file - current_move.from.file;
+
+    // When user has double clicked on a piece, we just ignore it
+    if (rank_displacement == 0 && file_displacement == 0)
+    {
+        return false;
+    }
+
+    // Getting the piece at the destination of the move made
+    chess_piece target = the_board.get_piece_at(current_move.to.rank, current_move.to.file);
+
+    // If the target tile contains a piece of the same color, this is an illegal move
+    // as we cannot capture our own pieces
+    if (target.type != NONE && target.color == piece.color)
+    {
+        return false;
+    }
+
+    // White pieces  move up while black pieces usually move down according to our board convention
+    int direction = (piece.color == WHITE) ? -1 : 1;
+
+    // Flag to know if the move played follows how pieces move according to chess rules
+    bool legal_move_played = false;
+    // Flag used to keep track if a castling attempt is illegal
+    bool improper_castle = false;
+
+    // Checking if move made is legal based on the type of the piece
+    switch (piece.type)
+    {
+    case PAWN:
+        if (!consider_attacks_only)
+        {
+            // If pawn moved by 1 rank in its allowed direction, it is acceptable
             if (file_displacement == 0 && rank_displacement == direction && target.type == NONE)
             {
                 legal_move_played = true;
             }
 
-            // If pawn tried to move by 2 ranks in its acceptable direction, check if the pawn has been moved since the start
-            // of the game
-            if (file_displacement == 0 && rank_displacement == 2 * direction && target.type == NONE)
+            // If pawn tried to move by 2 ranks in its acceptable direction, check if the pawn has been moved since the start
+            // of the game
+            if (file_displacement == 0 && rank_displacement == 2 * direction && target.type == NONE)
+            {
+                int start_rank = (piece.color == WHITE) ? 6 : 1;
+
+                // If the pawn is still at its start rank and there is nothing in its way, it can move by 2 ranks in its allowed direction
+                if (current_move.from.rank == start_rank && the_board.get_piece_at(current_move.from.rank + direction, current_move.from.file).type == NONE)
+                {
+                    legal_move_played = true;
+                }
+            }
+        }
+
+        // Normal pawn capture. No need to check color of piece at destination square as this has already been handled
+        // at the start of the function
+        if (abs(file_displacement) == 1 && rank_displacement == direction && target.type != NONE)
+        {
+            legal_move_played = true;
+        }
+
+        // En passant pawn capture
+        if (abs(file_displacement) == 1 && rank_displacement == direction && target.type == NONE)
+        {
+            square en_passant_target = the_board.get_en_passant_target();
+            if (current_move.to.rank == en_passant_target.rank && current_move.to.file == en_passant_target.file)
+            {
+                chess_piece piece_captured = the_board.get_piece_at(current_move.to.rank - direction, current_move.to.file);
+                if (piece_captured.type == PAWN && piece_captured.color != piece.color)
+                {
+                    legal_move_played = true;
+                }
+            }
+        }
+        break;
+    case ROOK:
+        legal_move_played = valid_rook_move(the_board, current_move, rank_displacement, file_displacement);
+        break;
+    case KNIGHT:
+        legal_move_played = (abs(rank_displacement) == 2 && abs(file_displacement) == 1) || (abs(rank_displacement) == 1 && abs(file_displacement) == 2);
+        break;
+    case BISHOP:
+        legal_move_played = valid_bishop_move(the_board, current_move, rank_displacement, file_displacement);
+        break;
+    case QUEEN:
+        legal_move_played = (valid_rook_move(the_board, current_move, rank_displacement, file_displacement) || valid_bishop_move(the_board, current_move, rank_displacement, file_displacement));
+        break;
+    case KING:
+        // If King tries to move by one square, it is acceptable. No need to check color of piece at destination
+        // square as this has already been handled at the start of the function
+        if (abs(rank_displacement) <= 1 && abs(file_displacement) <= 1)
+        {
+            legal_move_played = true;
+            break;
+        }
+
+        if (!consider_attacks_only)
+        {
+            // Attempt at castling
+            if (rank_displacement == 0 && abs(file_displacement) == 2)
+            {
+                int from_rank = current_move.from.rank;
+                // Deciding if it is a king side castle or queen side castle depending on the sign of file_displacement
+                bool king_side = (file_displacement == 2);
+
+                // The king cannot castle if it is in check
+                if (the_board.king_in_check(piece.color))
+                {
+                    legal_move_played = false;
+                    break;
+                }
+
+                chess_piece piece_on_rook_square = the_board.get_piece_at(current_move.to.rank, king_side? (BOARD_SIZE-1):0);
+
+                // Check if the rook is still present on the board
+                if (piece_on_rook_square.type !=ROOK || piece_on_rook_square.color != piece.color){
+                    legal_move_played = false;
+                    break;
+                }
+
+                // Checking if any of the pieces involved in the castle have been moved from the start of the game
+                if (piece.color == WHITE)
+                {
+                    if (the_board.get_white_king_moved() || (king_side && the_board.get_white_rook_h_moved()) || (!king_side && the_board.get_white_rook_a_moved()))
+                    {
+                        legal_move_played = false;
+                        break;
+                    }
+                }
+                else
+                {
+                    if (the_board.get_black_king_moved() || (king_side && the_board.get_black_rook_h_moved()) || (!king_side && the_board.get_black_rook_a_moved()))
+                    {
+                        legal_move_played = false;
+                        break;
+                    }
+                }
+
+                // Checking if there are any pieces blocking the castle.
+                if (king_side)
+                {
+                    for (int file_number = current_move.from.file + 1; file_number < BOARD_SIZE - 1; file_number++)
+                    {
+                        if (the_board.get_piece_at(from_rank, file_number).type != NONE)
+                        {
+                            legal_move_played = false;
+                            improper_castle = true;
+                            break;
+                        }
+                    }
+
+                    if (improper_castle)
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    for (int file_number = 1; file_number < current_move.from.file; file_number++)
+                    {
+                        if (the_board.get_piece_at(from_rank, file_number).type != NONE)
+                        {
+                            legal_move_played = false;
+                            improper_castle = true;
+                            break;
+                        }
+                    }
+
+                    if (improper_castle)
+                    {
+                        break;
+                    }
+                }
+
+                // Preventing castling if there is any attack on the king if it castles
+                bool square_attacked = false;
+                int step = (king_side) ? 1 : -1;
+                piece_color opponent_color = (piece.color == WHITE) ? BLACK : WHITE;
+
+                for (int board_file = current_move.from.file; board_file != current_move.to.file + step; board_file += step)
+                {
+                    square temp_tile = {from_rank, board_file};
+
+                    if (the_board.is_square_attacked(temp_tile, opponent_color))
+                    {
+                        square_attacked = true;
+                        break;
+                    }
+                }
+
+                // If there is an attack on the king when it castles, this is an invalid castle
+                if (square_attacked)
+                {
+                    legal_move_played = false;
+                    break;
+                }
+
+                legal_move_played = true;
+                break;
+            }
+        }
+
+        // King tried to move illegally
+        legal_move_played = false;
+        break;
+
+    default:
+        throw "Unhandled piece type";
+        break;
+    }
+
+    // If consider attacks only is true, this means that is_legal_move has been called from valid_move_simulated indirectly
+    if (consider_attacks_only)
+    {
+        return legal_move_played;
+    }
+    else
+    {
+        // Must create a new board object as we cannot pass the board as a const to valid_move_simulated
+        board temp_board = the_board;
+        return valid_move_simulated(temp_board, current_move, legal_move_played);
+    }
+}
+
+bool valid_rook_move(const board &the_board, const move &current_move, int rank_displacement, int file_displacement)
+{
+    // A rook cannot move diagonally
+    if (rank_displacement != 0 && file_displacement != 0)
+    {
+        return false;
+    }
+
+    int single_step_rank;
+    int single_step_file;
+
+    // Getting the step directions
+    if (rank_displacement == 0)
+    {
+        single_step_rank = 0;
+    }
+    else if (rank_displacement > 0)
+    {
+        single_step_rank = 1;
+    }
+    else
+    {
+        single_step_rank = -1;
+    }
+
+    if (file_displacement == 0)
+    {
+        single_step_file = 0;
+    }
+    else if (file_displacement > 0)
+    {
+        single_step_file = 1;
+    }
+    else
+    {
+        single_step_file = -1;
+    }
+
+    return check_for_obstruction(the_board, current_move, single_step_rank, single_step_file);
+}
+
+bool valid_bishop_move(const board &the_board, const move &current_move, int rank_displacement, int file_displacement)
+{
+    // The path moved by a bishop must always be the hypotenuse of an isosceles triangle
+    if (abs(rank_displacement) != abs(file_displacement))
+    {
+        return false;
+    }
+
+    // Getting the step directions
+    int single_step_rank = (rank_displacement > 0) ? 1 : -1;
+    int single_step_file = (file_displacement > 0) ? 1 : -1;
+
+    return check_for_obstruction(the_board, current_move, single_step_rank, single_step_file);
+}
+
+bool check_for_obstruction(const board &the_board, const move &current_move, int single_step_rank, int single_step_file)
+{
+    int new_rank = current_move.from.rank + single_step_rank;
+    int new_file = current_move.from.file + single_step_file;
+
+    // We just move the piece step by step in the direction of its final displacement and check each time
+    // if it meets another piece in the middle of its path before reaching its destination, because if it does, it means
+    // that the move is illegal, as it consists of jumping over a piece.
+    while (new_rank != current_move.to.rank || new_file != current_move.to.file)
+    {
+        if (the_board.get_piece_at(new_rank, new_file).type != NONE)
+        {
+            return false;
+        }
+
+        new_rank += single_step_rank;
+        new_file += single_step_file;
+    }
+
+    return true;
+}
+
+int determine_game_phase(const board &the_board)
+{
+    // The phase weight is updated by the board each time a piece is placed or removed. Promotions can take it
+    // above the weight of the starting position, so it is capped
+    return min(the_board.get_phase_weight(), MAX_PHASE_WEIGHT);
+}
+
+int taper_score(int packed_score, int phase)
+{
+    return (middlegame_value(packed_score) * phase + endgame_value(packed_score) * (MAX_PHASE_WEIGHT - phase)) / MAX_PHASE_WEIGHT;
+}
+
+int piece_square_value(const chess_piece &piece, const square &tile)
+{
+    if (piece.type == NONE)
+    {
+        return 0;
+    }
+
+    return piece_square_score_table.scores[piece.type][piece.color][tile.rank * BOARD_SIZE + tile.file];
+}
+
+// Names of the scalar parameters and of the piece tables in a parameter file
+static const char *const SCALAR_PARAMETER_NAMES[SCALAR_PARAMETER_COUNT] = {
+    "material_weight", "positional_weight", "mobility_weight", "king_safety_weight", "pawn_structure_weight",
+    "center_control_weight", "threat_weight", "pawn_defender_score", "double_pawn_penalty", "isolated_pawn_penalty",
+    "backward_pawn_penalty", "connected_pawn_bonus"};
+static const char *const PIECE_TYPE_NAMES[TYPE_OF_PIECE_COUNT] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+static const char *const GAME_STAGE_NAMES[GAME_STAGE_COUNT] = {"middlegame", "endgame"};
+
+const evaluation_parameters &get_evaluation_parameters()
+{
+    return parameters;
+}
+
+void set_evaluation_parameters(const evaluation_parameters &new_parameters)
+{
+    parameters = new_parameters;
+    piece_square_score_table = generate_piece_square_scores(parameters);
+
+    clear_evaluation_caches();
+}
+
+void clear_evaluation_caches()
+{
+    std::fill(std::begin(pawn_hash_table), std::end(pawn_hash_table), pawn_hash_entry{});
+    std::fill(std::begin(material_hash_table), std::end(material_hash_table), material_hash_entry{});
+    std::fill(std::begin(evaluation_cache), std::end(evaluation_cache), evaluation_cache_entry{});
+}
+
+bool load_evaluation_parameters(const string &path)
+{
+    ifstream file(path);
+
+    if (!file)
+    {
+        SDL_Log("Failed to open the parameter file %s", path.c_str());
+        return false;
+    }
+
+    evaluation_parameters new_parameters = parameters;
+    string name;
+
+    while (file >> name)
+    {
+        int *values = nullptr;
+        int count = 0;
+
+        for (int parameter = 0; parameter < SCALAR_PARAMETER_COUNT; parameter++)
+        {
+            if (name == SCALAR_PARAMETER_NAMES[parameter])
             {
-                int start_rank = (piece.color == WHITE) ? 6 : 1;
+                values = &new_parameters.scalars[parameter];
+                count = 1;
+            }
+        }
 
-                // If the pawn is still at its start rank and there is nothing in its way, it can move by 2 ranks in its allowed direction
-                if (current_move.from.rank == start_rank && the_board.get_piece_at(current_move.from.rank + direction, current_move.from.file).type == NONE)
+        // Piece tables are named after the piece type and the game stage, for example knight_endgame
+        for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+        {
+            for (int stage = MIDDLEGAME_STAGE; stage < GAME_STAGE_COUNT; stage++)
+            {
+                if (name == string(PIECE_TYPE_NAMES[type]) + "_" + GAME_STAGE_NAMES[stage])
                 {
-                    legal_move_played = true;
+                    values = new_parameters.piece_tables[type][stage];
+                    count = BOARD_SIZE * BOARD_SIZE;
                 }
             }
         }
 
-        // Normal pawn capture. No need to check color of piece at destination square as this has already been handled
-        // at the start of the function
-        if (abs(file_displacement) == 1 && rank_displacement == direction && target.type != NONE)
+        if (values == nullptr)
+        {
+            SDL_Log("Unknown parameter %s in the parameter file %s", name.c_str(), path.c_str());
+            return false;
+        }
+
+        for (int index = 0; index < count; index++)
+        {
+            if (!(file >> values[index]))
+            {
+                SDL_Log("Missing value of the parameter %s in the parameter file %s", name.c_str(), path.c_str());
+                return false;
+            }
+        }
+    }
+
+    set_evaluation_parameters(new_parameters);
+
+    return true;
+}
+
+bool save_evaluation_parameters(const string &path, const evaluation_parameters &saved_parameters)
+{
+    std::ofstream file(path);
+
+    for (int parameter = 0; parameter < SCALAR_PARAMETER_COUNT; parameter++)
+    {
+        file << SCALAR_PARAMETER_NAMES[parameter] << " " << saved_parameters.scalars[parameter] << "\n";
+    }
+
+    for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+    {
+        for (int stage = MIDDLEGAME_STAGE; stage < GAME_STAGE_COUNT; stage++)
+        {
+            file << PIECE_TYPE_NAMES[type] << "_" << GAME_STAGE_NAMES[stage];
+
+            for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile++)
+            {
+                file << (tile % BOARD_SIZE == 0 ? "\n   " : " ") << saved_parameters.piece_tables[type][stage][tile];
+            }
+
+            file << "\n";
+        }
+    }
+
+    return (bool)file;
+}
+
+/**
+ * @brief The function computes the packed piece square score of a whole board one tile at a time
+ *
+ * @param piece_codes is the piece code of every tile
+ *
+ * @return the packed piece square score
+ */
+static int scalar_piece_square_rescan(const uint8_t *piece_codes)
+{
+    // The scores of piece code c on tile t are found at (c - 1) * BOARD_SIZE * BOARD_SIZE + t
+    const int *scores = &piece_square_score_table.scores[0][0][0];
+    int score = 0;
+
+    for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile++)
+    {
+        if (piece_codes[tile] != EMPTY_PIECE_CODE)
+        {
+            score += scores[(piece_codes[tile] - 1) * BOARD_SIZE * BOARD_SIZE + tile];
+        }
+    }
+
+    return score;
+}
+
+#ifdef PIECE_SQUARE_AVX2
+
+/**
+ * @brief The function computes the packed piece square score of a whole board, gathering the scores of 8 tiles at
+ * a time. Packed scores are added up like plain integers, so the 8 partial sums are added at the end.
+ *
+ * @param piece_codes is the piece code of every tile
+ *
+ * @return the packed piece square score
+ */
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+static int avx2_piece_square_rescan(const uint8_t *piece_codes)
+{
+    const int *scores = &piece_square_score_table.scores[0][0][0];
+    __m256i tiles = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i ones = _mm256_set1_epi32(1);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile += 8)
+    {
+        __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(piece_codes + tile)));
+
+        // Shifting by 6 multiplies by the BOARD_SIZE * BOARD_SIZE tiles of each piece code. Empty tiles are left out
+        // of the gather, so their negative index is never read
+        __m256i indices = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(codes, ones), 6), tiles);
+        __m256i occupied = _mm256_cmpgt_epi32(codes, _mm256_setzero_si256());
+
+        sum = _mm256_add_epi32(sum, _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), scores, indices, occupied, 4));
+        tiles = _mm256_add_epi32(tiles, _mm256_set1_epi32(8));
+    }
+
+    __m128i half_sum = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(half_sum);
+}
+
+#endif
+
+/**
+ * @brief The function finds the fastest piece square kernel supported by the processor. MSVC cannot check the
+ * processor here, so it only uses the AVX2 kernel in builds which require AVX2.
+ *
+ * @return the kernel
+ */
+static piece_square_kernel fastest_piece_square_kernel()
+{
+#if defined(PIECE_SQUARE_AVX2) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2_PIECE_SQUARE_KERNEL;
+    }
+#elif defined(PIECE_SQUARE_AVX2) && defined(__AVX2__)
+    return AVX2_PIECE_SQUARE_KERNEL;
+#endif
+
+    return SCALAR_PIECE_SQUARE_KERNEL;
+}
+
+static const piece_square_kernel best_piece_square_kernel = fastest_piece_square_kernel(); // Fastest kernel of the processor
+static piece_square_kernel current_piece_square_kernel = best_piece_square_kernel;        // Kernel in use
+
+int piece_square_rescan(const uint8_t *piece_codes)
+{
+#ifdef PIECE_SQUARE_AVX2
+    if (current_piece_square_kernel == AVX2_PIECE_SQUARE_KERNEL)
+    {
+        return avx2_piece_square_rescan(piece_codes);
+    }
+#endif
+
+    return scalar_piece_square_rescan(piece_codes);
+}
+
+bool set_piece_square_kernel(piece_square_kernel kernel)
+{
+    if (kernel > best_piece_square_kernel)
+    {
+        return false;
+    }
+
+    current_piece_square_kernel = kernel;
+
+    return true;
+}
+
+piece_square_kernel get_piece_square_kernel()
+{
+    return current_piece_square_kernel;
+}
+
+bool batch_evaluate(const string &path)
+{
+    ifstream file(path);
+
+    if (!file)
+    {
+        SDL_Log("Failed to open the position file %s", path.c_str());
+        return false;
+    }
+
+    board the_board;
+    string fen;
+    int positions = 0;
+    int invalid_positions = 0;
+    uint64_t evaluation_nanoseconds = 0;
+
+    while (getline(file, fen))
+    {
+        if (fen.empty())
+        {
+            continue;
+        }
+
+        if (!the_board.load_fen(fen))
         {
-            legal_move_played = true;
+            SDL_Log("Invalid position : %s", fen.c_str());
+            invalid_positions++;
+            continue;
         }
 
-        // En passant pawn capture
-        if (abs(file_displacement) == 1 && rank_displacement == direction && target.type == NONE)
+        if (!the_board.verify_incremental_state())
         {
-            square en_passant_target = the_board.get_en_passant_target();
-            if (current_move.to.rank == en_passant_target.rank && current_move.to.file == en_passant_target.file)
-            {
-                chess_piece piece_captured = the_board.get_piece_at(current_move.to.rank - direction, current_move.to.file);
-                if (piece_captured.type == PAWN && piece_captured.color != piece.color)
-                {
-                    legal_move_played = true;
-                }
-            }
+            SDL_Log("Incremental state does not match the board : %s", fen.c_str());
+            invalid_positions++;
+            continue;
         }
-        break;
-    case ROOK:
-        legal_move_played = valid_rook_move(the_board, current_move, rank_displacement, file_displacement);
-        break;
-    case KNIGHT:
-        legal_move_played = (abs(rank_displacement) == 2 && abs(file_displacement) == 1) || (abs(rank_displacement) == 1 && abs(file_displacement) == 2);
-        break;
-    case BISHOP:
-        legal_move_played = valid_bishop_move(the_board, current_move, rank_displacement, file_displacement);
-        break;
-    case QUEEN:
-        legal_move_played = (valid_rook_move(the_board, current_move, rank_displacement, file_displacement) || valid_bishop_move(the_board, current_move, rank_displacement, file_displacement));
-        break;
-    case KING:
-        // If King tries to move by one square, it is acceptable. No need to check color of piece at destination
-        // square as this has already been handled at the start of the function
-        if (abs(rank_displacement) <= 1 && abs(file_displacement) <= 1)
+
+        // The window is wide open, so every evaluation term is computed
+        piece_color player_color = the_board.get_side_to_move();
+        uint64_t start_time = current_nanoseconds();
+        int evaluation = evaluate_board(the_board, 0, player_color, the_board.king_in_check(player_color), -CHECKMATE_SCORE, CHECKMATE_SCORE);
+
+        evaluation_nanoseconds += current_nanoseconds() - start_time;
+        positions++;
+
+        SDL_Log("%s : %d", fen.c_str(), evaluation);
+
+        if (evaluation_tracing)
         {
-            legal_move_played = true;
-            break;
+            log_evaluation_trace(the_board);
         }
+    }
 
-        if (!consider_attacks_only)
-        {
-            // Attempt at castling
-            if (rank_displacement == 0 && abs(file_displacement) == 2)
-            {
-                int from_rank = current_move.from.rank;
-                // Deciding if it is a king side castle or queen side castle depending on the sign of file_displacement
-                bool king_side = (file_displacement == 2);
+    SDL_Log("Evaluated %d positions in %.3f ms, %d invalid", positions, evaluation_nanoseconds / 1e6, invalid_positions);
 
-                // The king cannot castle if it is in check
-                if (the_board.king_in_check(piece.color))
-                {
-                    legal_move_played = false;
-                    break;
-                }
+    return invalid_positions == 0;
+}
 
-                chess_piece piece_on_rook_square = the_board.get_piece_at(current_move.to.rank, king_side? (BOARD_SIZE-1):0);
+int piece_square_evaluation(const board &the_board)
+{
+    // The piece square score is updated by the board each time a piece is placed or removed. Its middlegame and
+    // endgame scores are blended according to how many pieces are left, so there is no jump between game phases
+    return taper_score(the_board.get_piece_square_score(), determine_game_phase(the_board));
+}
 
-                // Check if the rook is still present on the board
-                if (piece_on_rook_square.type !=ROOK || piece_on_rook_square.color != piece.color){
-                    legal_move_played = false;
-                    break;
-                }
+attack_info compute_attack_info(const board &the_board)
+{
+    attack_info attacks;
 
-                // Checking if any of the pieces involved in the castle have been moved from the start of the game
-                if (piece.color == WHITE)
-                {
-                    if (the_board.get_white_king_moved() || (king_side && the_board.get_white_rook_h_moved()) || (!king_side && the_board.get_white_rook_a_moved()))
-                    {
-                        legal_move_played = false;
-                        break;
-                    }
-                }
-                else
-                {
-                    if (the_board.get_black_king_moved() || (king_side && the_board.get_black_rook_h_moved()) || (!king_side && the_board.get_black_rook_a_moved()))
-                    {
-                        legal_move_played = false;
-                        break;
-                    }
-                }
+    attacks.occupied = the_board.get_color_bitboard(WHITE) | the_board.get_color_bitboard(BLACK);
 
-                // Checking if there are any pieces blocking the castle.
-                if (king_side)
-                {
-                    for (int file_number = current_move.from.file + 1; file_number < BOARD_SIZE - 1; file_number++)
-                    {
-                        if (the_board.get_piece_at(from_rank, file_number).type != NONE)
-                        {
-                            legal_move_played = false;
-                            improper_castle = true;
-                            break;
-                        }
-                    }
+    // Getting the zone around each king
+    uint64_t king_zone[LAST_COLOR] = {};
 
-                    if (improper_castle)
-                    {
-                        break;
-                    }
-                }
-                else
-                {
-                    for (int file_number = 1; file_number < current_move.from.file; file_number++)
-                    {
-                        if (the_board.get_piece_at(from_rank, file_number).type != NONE)
-                        {
-                            legal_move_played = false;
-                            improper_castle = true;
-                            break;
-                        }
-                    }
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        uint64_t king = the_board.get_piece_bitboard((piece_color)color, KING);
 
-                    if (improper_castle)
-                    {
-                        break;
-                    }
-                }
+        if (king)
+        {
+            king_zone[color] = BITBOARD_MASKS.king_zone[color][countr_zero(king)];
+        }
+    }
 
-                // Preventing castling if there is any attack on the king if it castles
-                bool square_attacked = false;
-                int step = (king_side) ? 1 : -1;
-                piece_color opponent_color = (piece.color == WHITE) ? BLACK : WHITE;
+    // Pawn attacks come first, as the mobility of the other pieces depends on them
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        attacks.attacked_by_type[color][PAWN] = pawn_attacks(the_board.get_piece_bitboard((piece_color)color, PAWN), (piece_color)color);
+    }
 
-                for (int board_file = current_move.from.file; board_file != current_move.to.file + step; board_file += step)
-                {
-                    square temp_tile = {from_rank, board_file};
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        piece_color enemy_color = (color == WHITE) ? BLACK : WHITE;
 
-                    if (the_board.is_square_attacked(temp_tile, opponent_color))
-                    {
-                        square_attacked = true;
-                        break;
-                    }
-                }
+        // Tiles taken by pieces of the same color or attacked by enemy pawns are not worth moving to
+        uint64_t available_tiles = ~the_board.get_color_bitboard((piece_color)color) & ~attacks.attacked_by_type[enemy_color][PAWN];
 
-                // If there is an attack on the king when it castles, this is an invalid castle
-                if (square_attacked)
+        for (int type = KNIGHT; type < LAST_TYPE; type++)
+        {
+            uint64_t pieces = the_board.get_piece_bitboard((piece_color)color, (piece_type)type);
+
+            while (pieces)
+            {
+                int tile = countr_zero(pieces);
+                pieces &= pieces - 1;
+
+                uint64_t piece_attack_tiles = piece_attacks({(piece_type)type, (piece_color)color}, tile, attacks.occupied);
+
+                attacks.attacked_by_type[color][type] |= piece_attack_tiles;
+                attacks.mobility[color] += PIECE_MOBILITY_VALUE[type] * popcount(piece_attack_tiles & available_tiles);
+
+                // Counting the attacks on the enemy king zone. A king cannot attack the enemy king, so it is not
+                // counted as an attacker
+                uint64_t king_zone_attacks = piece_attack_tiles & king_zone[enemy_color];
+
+                if (type != KING && king_zone_attacks)
                 {
-                    legal_move_played = false;
-                    break;
+                    attacks.king_attackers_count[color]++;
+                    attacks.king_attack_units[color] += KING_ATTACK_WEIGHT[type] * popcount(king_zone_attacks);
                 }
-
-                legal_move_played = true;
-                break;
             }
         }
 
-        // King tried to move illegally
-        legal_move_played = false;
-        break;
-
-    default:
-        throw "Unhandled piece type";
-        break;
+        for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
+        {
+            attacks.attacked_by[color] |= attacks.attacked_by_type[color][type];
+        }
     }
 
-    // If consider attacks only is true, this means that is_legal_move has been called from valid_move_simulated indirectly
-    if (consider_attacks_only)
-    {
-        return legal_move_played;
-    }
-    else
-    {
-        // Must create a new board object as we cannot pass the board as a const to valid_move_simulated
-        board temp_board = the_board;
-        return valid_move_simulated(temp_board, current_move, legal_move_played);
-    }
+    return attacks;
 }
 
-bool valid_rook_move(const board &the_board, const move &current_move, int rank_displacement, int file_displacement)
+int mobility_evaluation(const attack_info &attacks)
 {
-    // A rook cannot move diagonally
-    if (rank_displacement != 0 && file_displacement != 0)
-    {
-        return false;
-    }
+    return attacks.mobility[WHITE] - attacks.mobility[BLACK];
+}
 
-    int single_step_rank;
-    int single_step_file;
+int king_safety_score(const board &the_board, const attack_info &attacks, piece_color color)
+{
+    piece_color enemy_color = (color == WHITE) ? BLACK : WHITE;
+    uint64_t king = the_board.get_piece_bitboard(color, KING);
 
-    // Getting the step directions
-    if (rank_displacement == 0)
-    {
-        single_step_rank = 0;
-    }
-    else if (rank_displacement > 0)
+    if (king == 0)
     {
-        single_step_rank = 1;
+        return 0;
     }
-    else
+
+    int king_file = countr_zero(king) % BOARD_SIZE;
+    int middlegame_score = 0;
+
+    // Pawns right in front of the king and one rank further protect it
+    uint64_t own_pawns = the_board.get_piece_bitboard(color, PAWN);
+    uint64_t shield_near = shift_forward(king | shift_file_up(king) | shift_file_down(king), color);
+    uint64_t shield_far = shift_forward(shield_near, color);
+
+    int pawn_defender_score = parameters.scalars[PAWN_DEFENDER_SCORE_PARAMETER];
+    middlegame_score += pawn_defender_score * popcount(own_pawns & shield_near) + pawn_defender_score / 2 * popcount(own_pawns & shield_far);
+
+    // Files without pawns around the king let rooks and queens reach it. The pawn hash table knows which files have pawns
+    const pawn_hash_entry &pawns = probe_pawn_hash(the_board);
+    uint8_t own_pawn_files = (color == WHITE) ? pawns.white_pawn_files : pawns.black_pawn_files;
+    uint8_t enemy_pawn_files = (color == WHITE) ? pawns.black_pawn_files : pawns.white_pawn_files;
+
+    for (int file = max(king_file - 1, 0); file <= min(king_file + 1, BOARD_SIZE - 1); file++)
     {
-        single_step_rank = -1;
+        if ((own_pawn_files & (1 << file)) == 0)
+        {
+            middlegame_score -= (enemy_pawn_files & (1 << file)) ? KING_SEMI_OPEN_FILE_PENALTY : KING_OPEN_FILE_PENALTY;
+        }
     }
 
-    if (file_displacement == 0)
+    // Enemy pieces attacking the king zone. The penalty grows quadratically with the attack units
+    int attack_penalty = 0;
+
+    if (attacks.king_attackers_count[enemy_color] >= 2)
     {
-        single_step_file = 0;
+        int attack_units = attacks.king_attack_units[enemy_color];
+        attack_penalty = min(attack_units * attack_units / 2, KING_ATTACK_MAX_PENALTY);
     }
-    else if (file_displacement > 0)
+
+    // The pawn shield and open files matter little once the pieces able to attack the king are gone, unlike the attacks
+    return make_score(middlegame_score - attack_penalty, -attack_penalty / 2);
+}
+
+int king_safety_evaluation(const board &the_board, const attack_info &attacks)
+{
+    int packed_score = king_safety_score(the_board, attacks, WHITE) - king_safety_score(the_board, attacks, BLACK);
+
+    return taper_score(packed_score, determine_game_phase(the_board));
+}
+
+int pawn_structure_score(uint64_t own_pawns, uint64_t enemy_pawns, piece_color color)
+{
+    piece_color enemy_color = (color == WHITE) ? BLACK : WHITE;
+    int middlegame_score = 0;
+    int endgame_score = 0;
+
+    uint8_t own_files = occupied_files(own_pawns);
+    uint64_t own_attacks = pawn_attacks(own_pawns, color);
+    uint64_t enemy_attacks = pawn_attacks(enemy_pawns, enemy_color);
+
+    // A pawn is doubled if another pawn of its color is in front of it. A file with n pawns has n - 1 doubled pawns
+    uint64_t doubled_pawns = own_pawns & forward_span(own_pawns, enemy_color);
+
+    // A pawn is isolated if there is no pawn of its color on the adjacent files
+    uint64_t pawn_files = BITBOARD_MASKS.file[0] * own_files;
+    uint64_t isolated_pawns = own_pawns & ~(shift_file_up(pawn_files) | shift_file_down(pawn_files));
+
+    // A pawn is backward if no pawn of its color can ever defend the tile in front of it, and an enemy pawn attacks
+    // that tile. Isolated pawns are already penalised
+    uint64_t stop_tiles = shift_forward(own_pawns, color);
+    uint64_t defendable_tiles = own_attacks | forward_span(own_attacks, color);
+    uint64_t backward_pawns = shift_forward(stop_tiles & enemy_attacks & ~defendable_tiles, enemy_color) & ~isolated_pawns;
+
+    // A pawn is connected if it is defended by a pawn of its color or stands next to one on the same rank
+    uint64_t connected_pawns = own_pawns & (own_attacks | shift_file_up(own_pawns) | shift_file_down(own_pawns));
+
+    int structure_score = parameters.scalars[CONNECTED_PAWN_BONUS_PARAMETER] * popcount(connected_pawns) -
+                          parameters.scalars[DOUBLE_PAWN_PENALTY_PARAMETER] * popcount(doubled_pawns) -
+                          parameters.scalars[ISOLATED_PAWN_PENALTY_PARAMETER] * popcount(isolated_pawns) -
+                          parameters.scalars[BACKWARD_PAWN_PENALTY_PARAMETER] * popcount(backward_pawns);
+
+    middlegame_score += structure_score;
+    endgame_score += structure_score;
+
+    // A pawn is passed if no enemy pawn can stop it on its way to promotion. The further it went, the bigger the bonus
+    uint64_t candidate_pawns = own_pawns & ~doubled_pawns;
+
+    while (candidate_pawns)
     {
-        single_step_file = 1;
+        int tile = countr_zero(candidate_pawns);
+        candidate_pawns &= candidate_pawns - 1;
+
+        if ((BITBOARD_MASKS.passed_pawn_span[color][tile] & enemy_pawns) == 0)
+        {
+            int rank = tile / BOARD_SIZE;
+            int ranks_advanced = (color == WHITE) ? BOARD_SIZE - 1 - rank : rank;
+
+            middlegame_score += PASSED_PAWN_BONUS_MIDDLEGAME[ranks_advanced];
+            endgame_score += PASSED_PAWN_BONUS_ENDGAME[ranks_advanced];
+        }
     }
-    else
+
+    return make_score(middlegame_score, endgame_score);
+}
+
+/**
+ * @brief The procedure evaluates the pawn structure of the board and fills a pawn hash table entry with the
+ * evaluation and the files on which each player has pawns
+ *
+ * @param the_board is the board state
+ * @param entry is the pawn hash table entry to fill
+ */
+static void evaluate_pawn_structure(const board &the_board, pawn_hash_entry &entry)
+{
+    uint64_t white_pawns = the_board.get_piece_bitboard(WHITE, PAWN);
+    uint64_t black_pawns = the_board.get_piece_bitboard(BLACK, PAWN);
+
+    entry.pawn_key = the_board.get_pawn_key();
+    entry.score = pawn_structure_score(white_pawns, black_pawns, WHITE) - pawn_structure_score(black_pawns, white_pawns, BLACK);
+    entry.white_pawn_files = occupied_files(white_pawns);
+    entry.black_pawn_files = occupied_files(black_pawns);
+}
+
+const pawn_hash_entry &probe_pawn_hash(const board &the_board)
+{
+    uint64_t pawn_key = the_board.get_pawn_key();
+    pawn_hash_entry &entry = pawn_hash_table[pawn_key & (PAWN_HASH_TABLE_SIZE - 1)];
+
+    // The pawn structure is only evaluated if it is not already in the table
+    if (entry.pawn_key != pawn_key)
     {
-        single_step_file = -1;
+        evaluate_pawn_structure(the_board, entry);
     }
 
-    return check_for_obstruction(the_board, current_move, single_step_rank, single_step_file);
+    return entry;
 }
 
-bool valid_bishop_move(const board &the_board, const move &current_move, int rank_displacement, int file_displacement)
+int pawn_structure_evaluation(const board &the_board)
 {
-    // The path moved by a bishop must always be the hypotenuse of an isosceles triangle
-    if (abs(rank_displacement) != abs(file_displacement))
+    // Passed pawns matter much more in the endgame, so the evaluation is tapered
+    return taper_score(probe_pawn_hash(the_board).score, determine_game_phase(the_board));
+}
+
+int center_control_score(const board &the_board, const attack_info &attacks, piece_color color)
+{
+    // Since a chess board will always have an even number of
+    // ranks and files, this formula will work
+    int middle_square = BOARD_SIZE / 2;
+    uint64_t center_tiles = tile_bitboard(middle_square - 1, middle_square - 1) | tile_bitboard(middle_square - 1, middle_square) |
+                            tile_bitboard(middle_square, middle_square - 1) | tile_bitboard(middle_square, middle_square);
+    int score = 0;
+
+    // Checking for pieces placed on or attacking the central squares
+    for (int type = FIRST_TYPE; type < LAST_TYPE; type++)
     {
-        return false;
+        int pieces_on_center = popcount(the_board.get_piece_bitboard(color, (piece_type)type) & center_tiles);
+        int center_tiles_attacked = popcount(attacks.attacked_by_type[color][type] & center_tiles);
+
+        score += CENTER_CONTROL_BONUS[type] * (pieces_on_center + center_tiles_attacked);
     }
 
-    // Getting the step directions
-    int single_step_rank = (rank_displacement > 0) ? 1 : -1;
-    int single_step_file = (file_displacement > 0) ? 1 : -1;
+    return score;
+}
+
+int center_control_evaluation(const board &the_board, const attack_info &attacks)
+{
+    return center_control_score(the_board, attacks, WHITE) - center_control_score(the_board, attacks, BLACK);
+}
+
+int threat_score(const board &the_board, const attack_info &attacks, piece_color color)
+{
+    piece_color enemy_color = (color == WHITE) ? BLACK : WHITE;
+
+    uint64_t enemy_pieces = the_board.get_color_bitboard(enemy_color) & ~the_board.get_piece_bitboard(enemy_color, KING);
+    uint64_t enemy_non_pawns = enemy_pieces & ~the_board.get_piece_bitboard(enemy_color, PAWN);
+    uint64_t enemy_major_pieces = the_board.get_piece_bitboard(enemy_color, ROOK) | the_board.get_piece_bitboard(enemy_color, QUEEN);
+    uint64_t minor_attacks = attacks.attacked_by_type[color][KNIGHT] | attacks.attacked_by_type[color][BISHOP];
+
+    // Pieces attacked by a pawn, which will usually lose material
+    int attacked_by_pawn_count = popcount(enemy_non_pawns & attacks.attacked_by_type[color][PAWN]);
+
+    // Rooks and queens attacked by minor pieces, and queens attacked by rooks
+    int attacked_by_lesser_piece_count = popcount(enemy_major_pieces & minor_attacks) +
+                                         popcount(the_board.get_piece_bitboard(enemy_color, QUEEN) & attacks.attacked_by_type[color][ROOK]);
+
+    // Pieces attacked which nothing defends
+    int hanging_count = popcount(enemy_pieces & attacks.attacked_by[color] & ~attacks.attacked_by[enemy_color]);
+
+    return attacked_by_pawn_count * THREAT_BY_PAWN_BONUS + attacked_by_lesser_piece_count * THREAT_BY_LESSER_PIECE_BONUS +
+           hanging_count * HANGING_PIECE_BONUS;
+}
 
-    return check_for_obstruction(the_board, current_move, single_step_rank, single_step_file);
+int threat_evaluation(const board &the_board, const attack_info &attacks)
+{
+    return threat_score(the_board, attacks, WHITE) - threat_score(the_board, attacks, BLACK);
 }
 
-bool check_for_obstruction(const board &the_board, const move &current_move, int single_step_rank, int single_step_file)
+bool insufficient_material(const board &the_board)
 {
-    int new_rank = current_move.from.rank + single_step_rank;
-    int new_file = current_move.from.file + single_step_file;
+    uint64_t signature = the_board.get_material_signature();
 
-    // We just move the piece step by step in the direction of its final displacement and check each time
-    // if it meets another piece in the middle of its path before reaching its destination, because if it does, it means
-    // that the move is illegal, as it consists of jumping over a piece.
-    while (new_rank != current_move.to.rank || new_file != current_move.to.file)
-    {
-        if (the_board.get_piece_at(new_rank, new_file).type != NONE)
-        {
-            return false;
-        }
+    // Pieces which can always force checkmate with the help of the king, a pawn being able to promote
+    uint64_t mating_material = 0;
 
-        new_rank += single_step_rank;
-        new_file += single_step_file;
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        mating_material |= material_signature_unit((piece_color)color, PAWN) * ((1 << MATERIAL_SIGNATURE_BITS) - 1);
+        mating_material |= material_signature_unit((piece_color)color, ROOK) * ((1 << MATERIAL_SIGNATURE_BITS) - 1);
+        mating_material |= material_signature_unit((piece_color)color, QUEEN) * ((1 << MATERIAL_SIGNATURE_BITS) - 1);
     }
 
-    return true;
-}
+    if (signature & mating_material)
+    {
+        return false;
+    }
 
-int material_evaluation(const board &the_board)
-{
-    int evaluation = 0;
-    piece_type type_of_piece;
+    int white_knights = the_board.get_piece_count(WHITE, KNIGHT);
+    int black_knights = the_board.get_piece_count(BLACK, KNIGHT);
+    int white_bishops = the_board.get_piece_count(WHITE, BISHOP);
+    int black_bishops = the_board.get_piece_count(BLACK, BISHOP);
 
-    // Looping through each white piece type and adjusting the evaluation according to their score
-    for (int index = 0; index < the_board.white_pieces_remaining.size(); index++)
+    // A single minor piece on the board cannot checkmate
+    if (white_knights + black_knights + white_bishops + black_bishops <= 1)
     {
-        type_of_piece = the_board.white_pieces_remaining[index];
-
-        if (type_of_piece != NONE)
-        {
-            evaluation += PIECE_VALUE[type_of_piece];
-        }
+        return true;
     }
 
-    // Looping through each black piece type and adjusting the evaluation according to their score
-    for (int index = 0; index < the_board.black_pieces_remaining.size(); index++)
+    // When only bishops are left, they cannot checkmate if they all stand on squares of the same color
+    if (white_knights + black_knights == 0)
     {
-        type_of_piece = the_board.black_pieces_remaining[index];
+        bool light_square_bishop = false;
+        bool dark_square_bishop = false;
 
-        if (type_of_piece != NONE)
+        for (int rank = 0; rank < BOARD_SIZE; rank++)
         {
-            evaluation -= PIECE_VALUE[type_of_piece];
+            for (int file = 0; file < BOARD_SIZE; file++)
+            {
+                if (the_board.get_piece_at(rank, file).type == BISHOP)
+                {
+                    ((rank + file) % 2 == 0 ? light_square_bishop : dark_square_bishop) = true;
+                }
+            }
         }
+
+        return !(light_square_bishop && dark_square_bishop);
     }
 
-    return evaluation;
+    return false;
 }
 
-game_phase determine_game_phase(const board &the_board)
+int material_imbalance_score(const board &the_board, piece_color color)
 {
-    int opening_phase = 0;
-    int current_phase = 0;
-    double phase_ratio = 0;
+    int pawns = the_board.get_piece_count(color, PAWN);
+    int middlegame_score = 0;
+    int endgame_score = 0;
 
-    piece_type type_of_piece;
-
-    // Getting the opening game phase (no pieces lost)
-    for (int piece_type = FIRST_TYPE; piece_type < LAST_TYPE; piece_type++)
+    // Two bishops cover squares of both colors, which a single bishop cannot
+    if (the_board.get_piece_count(color, BISHOP) >= 2)
     {
-        opening_phase += OPENING_PIECES_COUNT[piece_type] * PIECE_PHASE_WEIGHT[piece_type];
+        middlegame_score += BISHOP_PAIR_BONUS_MIDDLEGAME;
+        endgame_score += BISHOP_PAIR_BONUS_ENDGAME;
     }
 
-    // Determining the current game phase weight //
+    // Knights like closed positions with many pawns, while rooks need the open files left by missing pawns
+    int pawn_adjustment = KNIGHT_PAWN_ADJUSTMENT * the_board.get_piece_count(color, KNIGHT) * (pawns - 5) -
+                          ROOK_PAWN_ADJUSTMENT * the_board.get_piece_count(color, ROOK) * (pawns - 5);
+
+    middlegame_score += pawn_adjustment;
+    endgame_score += pawn_adjustment;
 
-    for (int index = 0; index < the_board.white_pieces_remaining.size(); index++)
+    return make_score(middlegame_score, endgame_score);
+}
+
+/**
+ * @brief The function checks if a player has nothing but the king left
+ *
+ * @param the_board is the state of the board
+ * @param color is the color of the player
+ *
+ * @return true if only the king is left and false otherwise
+ */
+static bool lone_king(const board &the_board, piece_color color)
+{
+    return the_board.get_color_bitboard(color) == the_board.get_piece_bitboard(color, KING);
+}
+
+/**
+ * @brief The procedure finds if the material configuration of the board is an endgame which has its own evaluation
+ * function, and fills a material hash table entry with it and the material imbalance
+ *
+ * @param the_board is the state of the board
+ * @param entry is the material hash table entry to fill
+ */
+static void evaluate_material(const board &the_board, material_hash_entry &entry)
+{
+    entry.material_signature = the_board.get_material_signature();
+    entry.imbalance = material_imbalance_score(the_board, WHITE) - material_imbalance_score(the_board, BLACK);
+    entry.endgame = GENERIC_ENDGAME;
+    entry.strong_side = WHITE;
+
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
     {
-        type_of_piece = the_board.white_pieces_remaining[index];
+        piece_color strong_side = (piece_color)color;
+        piece_color weak_side = (strong_side == WHITE) ? BLACK : WHITE;
 
-        if (type_of_piece != NONE)
+        if (!lone_king(the_board, weak_side) || lone_king(the_board, strong_side))
         {
-            current_phase += PIECE_PHASE_WEIGHT[type_of_piece];
+            continue;
         }
-    }
 
-    for (int index = 0; index < the_board.black_pieces_remaining.size(); index++)
-    {
-        type_of_piece = the_board.black_pieces_remaining[index];
+        int pawns = the_board.get_piece_count(strong_side, PAWN);
+        int knights = the_board.get_piece_count(strong_side, KNIGHT);
+        int bishops = the_board.get_piece_count(strong_side, BISHOP);
+        int major_pieces = the_board.get_piece_count(strong_side, ROOK) + the_board.get_piece_count(strong_side, QUEEN);
+
+        entry.strong_side = strong_side;
 
-        if (type_of_piece != NONE)
+        if (pawns == 1 && knights + bishops + major_pieces == 0)
+        {
+            entry.endgame = KPK_ENDGAME;
+        }
+        else if (pawns == 0 && major_pieces == 0 && knights == 1 && bishops == 1)
         {
-            current_phase += PIECE_PHASE_WEIGHT[type_of_piece];
+            entry.endgame = KBNK_ENDGAME;
+        }
+        else if (major_pieces > 0 || bishops >= 2)
+        {
+            entry.endgame = KXK_ENDGAME;
         }
     }
+}
 
-    // Calculating phase ratio
-    phase_ratio = (double)current_phase / opening_phase;
+const material_hash_entry &probe_material_hash(const board &the_board)
+{
+    uint64_t signature = the_board.get_material_signature();
+    material_hash_entry &entry = material_hash_table[((signature * 0x9E3779B97F4A7C15ULL) >> 32) & (MATERIAL_HASH_TABLE_SIZE - 1)];
 
-    // Determining game phase based on phase ratio
-    if (phase_ratio > ((double)OPENING_PHASE_RATIO / 100.0))
+    // The material configuration is only evaluated if it is not already in the table
+    if (entry.material_signature != signature)
     {
-        return OPENING;
-    }
-    else if (phase_ratio > ((double)MIDDLE_GAME_PHASE_RATIO / 100.0))
-    {
-        return MIDDLE_GAME;
-    }
-    else
-    {
-        return ENDGAME;
+        evaluate_material(the_board, entry);
     }
+
+    return entry;
 }
 
-int positional_evaluation(const board &the_board)
+int material_imbalance_evaluation(const board &the_board)
 {
-    int evaluation = 0;
-    int piece_positional_score = 0;
-    chess_piece piece;
+    return taper_score(probe_material_hash(the_board).imbalance, determine_game_phase(the_board));
+}
 
-    // Determining in which phase of the game we are.
-    game_phase stage_of_game = determine_game_phase(the_board);
+/**
+ * @brief The function returns how many king moves separate two tiles
+ *
+ * @param first_tile is the first tile, as rank * BOARD_SIZE + file
+ * @param second_tile is the second tile, as rank * BOARD_SIZE + file
+ *
+ * @return the distance between the tiles
+ */
+static int king_distance(int first_tile, int second_tile)
+{
+    return max(abs(first_tile / BOARD_SIZE - second_tile / BOARD_SIZE), abs(first_tile % BOARD_SIZE - second_tile % BOARD_SIZE));
+}
 
-    // Getting each piece found on the board and calculating its positional score
-    for (int rank = 0; rank < BOARD_SIZE; rank++)
-    {
-        for (int file = 0; file < BOARD_SIZE; file++)
-        {
-            piece = the_board.get_piece_at(rank, file);
+/**
+ * @brief The function returns how far a tile is from the 4 central tiles, counting ranks and files
+ *
+ * @param tile is the tile, as rank * BOARD_SIZE + file
+ *
+ * @return the distance from the center, between 0 and 6
+ */
+static int center_distance(int tile)
+{
+    int rank = tile / BOARD_SIZE;
+    int file = tile % BOARD_SIZE;
 
-            if (piece.type == NONE)
-            {
-                continue;
-            }
+    return max(BOARD_SIZE / 2 - 1 - rank, rank - BOARD_SIZE / 2) + max(BOARD_SIZE / 2 - 1 - file, file - BOARD_SIZE / 2);
+}
 
-            square piece_square = {rank, file};
+int kxk_evaluation(const board &the_board, piece_color strong_side)
+{
+    piece_color weak_side = (strong_side == WHITE) ? BLACK : WHITE;
+    int strong_king = countr_zero(the_board.get_piece_bitboard(strong_side, KING));
+    int weak_king = countr_zero(the_board.get_piece_bitboard(weak_side, KING));
+    int sign = (strong_side == WHITE) ? 1 : -1;
 
-            // Gettting the score from the relevant piece square table
-            switch (piece.type)
-            {
-            case PAWN:
-                if (stage_of_game == OPENING)
-                {
-                    piece_positional_score = pawn_piece_table_opening[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else if (stage_of_game == MIDDLE_GAME)
-                {
-                    piece_positional_score = pawn_piece_table_middlegame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else
-                {
-                    piece_positional_score = pawn_piece_table_endgame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                break;
+    int score = sign * piece_square_evaluation(the_board) +
+                MOPUP_EDGE_BONUS * center_distance(weak_king) +
+                MOPUP_PROXIMITY_BONUS * (BOARD_SIZE - 1 - king_distance(strong_king, weak_king));
 
-            case KNIGHT:
-                if (stage_of_game == OPENING)
-                {
-                    piece_positional_score = knight_piece_table_opening[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else if (stage_of_game == MIDDLE_GAME)
-                {
-                    piece_positional_score = knight_piece_table_middlegame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else
-                {
-                    piece_positional_score = knight_piece_table_endgame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                break;
-            case BISHOP:
-                if (stage_of_game == OPENING)
-                {
-                    piece_positional_score = bishop_piece_table_opening[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else if (stage_of_game == MIDDLE_GAME)
-                {
-                    piece_positional_score = bishop_piece_table_middlegame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else
-                {
-                    piece_positional_score = bishop_piece_table_endgame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                break;
-            case ROOK:
-                if (stage_of_game == OPENING)
-                {
-                    piece_positional_score = rook_piece_table_opening[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else if (stage_of_game == MIDDLE_GAME)
-                {
-                    piece_positional_score = rook_piece_table_middlegame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else
-                {
-                    piece_positional_score = rook_piece_table_endgame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                break;
-            case QUEEN:
-                piece_positional_score = queen_piece_table[(piece.color == WHITE ? rank : 7 - rank)][file];
-                break;
-            case KING:
-                if (stage_of_game == OPENING)
-                {
-                    piece_positional_score = king_piece_table_opening[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else if (stage_of_game == MIDDLE_GAME)
-                {
-                    piece_positional_score = king_piece_table_middlegame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                else
-                {
-                    piece_positional_score = king_piece_table_endgame[(piece.color == WHITE ? rank : 7 - rank)][file];
-                }
-                break;
-            default:
-                piece_positional_score = 0;
-                break;
-            }
+    return sign * score;
+}
 
-            evaluation += (piece.color == WHITE) ? piece_positional_score : -piece_positional_score;
-        }
+int kbnk_evaluation(const board &the_board, piece_color strong_side)
+{
+    piece_color weak_side = (strong_side == WHITE) ? BLACK : WHITE;
+    int strong_king = countr_zero(the_board.get_piece_bitboard(strong_side, KING));
+    int weak_king = countr_zero(the_board.get_piece_bitboard(weak_side, KING));
+    int bishop = countr_zero(the_board.get_piece_bitboard(strong_side, BISHOP));
+    int sign = (strong_side == WHITE) ? 1 : -1;
+
+    // Corners a1/h8 and a8/h1 have opposite colors. Tiles of the same color have the same rank + file parity
+    int corner_distance = 0;
+
+    if ((bishop / BOARD_SIZE + bishop % BOARD_SIZE) % 2 == 0)
+    {
+        corner_distance = min(king_distance(weak_king, 0), king_distance(weak_king, BOARD_SIZE * BOARD_SIZE - 1));
+    }
+    else
+    {
+        corner_distance = min(king_distance(weak_king, BOARD_SIZE - 1), king_distance(weak_king, BOARD_SIZE * (BOARD_SIZE - 1)));
     }
 
-    return evaluation;
+    int score = sign * piece_square_evaluation(the_board) +
+                KBNK_CORNER_BONUS * (BOARD_SIZE - 1 - corner_distance) +
+                MOPUP_PROXIMITY_BONUS * (BOARD_SIZE - 1 - king_distance(strong_king, weak_king));
+
+    return sign * score;
 }
 
-int mobility_evaluation(board &the_board)
+int kpk_evaluation(const board &the_board, piece_color strong_side)
 {
-    chess_piece piece;
-    move current_move = {{-1, -1}, {-1, -1}};
-    vector<move> white_legal_moves = {};
-    vector<move> black_legal_moves = {};
-    int mobility_score = 0;
+    piece_color weak_side = (strong_side == WHITE) ? BLACK : WHITE;
+    int strong_king = countr_zero(the_board.get_piece_bitboard(strong_side, KING));
+    int weak_king = countr_zero(the_board.get_piece_bitboard(weak_side, KING));
+    int pawn = countr_zero(the_board.get_piece_bitboard(strong_side, PAWN));
+    int sign = (strong_side == WHITE) ? 1 : -1;
+
+    int pawn_rank = pawn / BOARD_SIZE;
+    int pawn_file = pawn % BOARD_SIZE;
+
+    // White pawns promote on rank 0 and black pawns on rank 7
+    int promotion_rank = (strong_side == WHITE) ? 0 : BOARD_SIZE - 1;
+    int promotion_tile = promotion_rank * BOARD_SIZE + pawn_file;
+    int pawn_distance = abs(promotion_rank - pawn_rank);
+
+    // A pawn on its starting rank can move 2 tiles at once
+    if (pawn_distance == BOARD_SIZE - 2)
+    {
+        pawn_distance--;
+    }
+
+    int score = sign * piece_square_evaluation(the_board);
 
-    // Getting the legal moves that black and white could play
-    white_legal_moves = generate_legal_moves(the_board, WHITE);
-    black_legal_moves = generate_legal_moves(the_board, BLACK);
+    // Rule of the square: the lone king cannot catch the pawn if it is too far from the promotion tile
+    int weak_king_distance = king_distance(weak_king, promotion_tile) - (the_board.get_side_to_move() == weak_side ? 1 : 0);
 
-    // Calculating the mobility scores //
+    if (weak_king_distance > pawn_distance)
+    {
+        return sign * (score + KPK_UNSTOPPABLE_BONUS);
+    }
 
-    for (int index = 0; index < white_legal_moves.size(); index++)
+    // The lone king cannot be driven out of the corner in front of a rook pawn
+    if ((pawn_file == 0 || pawn_file == BOARD_SIZE - 1) && king_distance(weak_king, promotion_tile) <= 1)
     {
-        current_move = white_legal_moves[index];
-        piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
+        return DRAW_SCORE;
+    }
 
-        if (piece.type != NONE)
-        {
-            mobility_score += PIECE_MOBILITY_VALUE[piece.type];
-        }
+    // A lone king standing in front of the pawn usually holds the draw, unless the other king is in front of the pawn too
+    bool weak_king_in_front = (weak_king % BOARD_SIZE == pawn_file) && abs(promotion_rank - weak_king / BOARD_SIZE) < abs(promotion_rank - pawn_rank);
+    bool strong_king_in_front = abs(promotion_rank - strong_king / BOARD_SIZE) < abs(promotion_rank - pawn_rank);
+
+    if (weak_king_in_front && !strong_king_in_front)
+    {
+        return sign * (score / KPK_DRAWISH_SCALE);
     }
 
-    for (int index = 0; index < black_legal_moves.size(); index++)
+    return sign * score;
+}
+
+/**
+ * @brief The function evaluates an endgame which has its own evaluation function
+ *
+ * @param the_board is the state of the board
+ * @param material is the material hash table entry of the board
+ *
+ * @return the evaluation, from white's point of view
+ */
+static int known_endgame_evaluation(const board &the_board, const material_hash_entry &material)
+{
+    switch (material.endgame)
     {
-        current_move = black_legal_moves[index];
-        piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
+    case KXK_ENDGAME:
+        return kxk_evaluation(the_board, material.strong_side);
+    case KBNK_ENDGAME:
+        return kbnk_evaluation(the_board, material.strong_side);
+    case KPK_ENDGAME:
+        return kpk_evaluation(the_board, material.strong_side);
+    default:
+        return 0;
+    }
+}
+
+int checkmated_score(piece_color checkmated_color, const int ply)
+{
+    // We add or substract the ply so that the AI chooses shortest path to checkmate
+    return (checkmated_color == WHITE) ? -CHECKMATE_SCORE + ply : CHECKMATE_SCORE - ply;
+}
 
-        if (piece.type != NONE)
+int evaluate_board(board &the_board, const int ply, piece_color player_color, const bool in_check, int alpha, int beta)
+{
+    // The neural network replaces all the handcrafted terms when it is chosen. Its evaluations are not cached, as
+    // the cache holds classic evaluations
+    if (get_evaluator() == NNUE_EVALUATOR)
+    {
+        if (!has_legal_move(the_board, player_color))
         {
-            mobility_score -= PIECE_MOBILITY_VALUE[piece.type];
+            return in_check ? checkmated_score(player_color, ply) : DRAW_SCORE;
         }
+
+        statistics.evaluations++;
+        return nnue_evaluation(the_board, player_color);
     }
 
-    return mobility_score;
+    return evaluate_board_terms<ENGINE_EVALUATION_FEATURES>(the_board, ply, player_color, in_check, alpha, beta);
 }
 
-int king_safety_evaluation(const board &the_board)
+template <int features>
+int evaluate_board_terms(board &the_board, const int ply, piece_color player_color, const bool in_check, int alpha, int beta)
 {
-    square white_king_tile = the_board.find_the_king(WHITE);
-    square black_king_tile = the_board.find_the_king(BLACK);
+    // Only the feature set of the engine may use the cache, otherwise evaluations of different feature sets would
+    // be mixed up
+    constexpr bool use_cache = (features == ENGINE_EVALUATION_FEATURES);
+    constexpr bool use_material_hash = (features & (MATERIAL_IMBALANCE_FEATURE | KNOWN_ENDGAME_FEATURE)) != 0;
+    constexpr bool use_attacks = (features & (MOBILITY_FEATURE | KING_SAFETY_FEATURE | CENTER_CONTROL_FEATURE | THREAT_FEATURE)) != 0;
+
+    // One evaluation in EVALUATION_PROFILE_SAMPLE_RATE is sampled, so that timing does not slow down the others.
+    // The time of sampled evaluations is used to estimate the speedup of the evaluation cache, and in trace mode the
+    // cost of each of their steps is measured
+    bool sampled = (++profile_counter & (EVALUATION_PROFILE_SAMPLE_RATE - 1)) == 0;
+    bool timed = use_cache && sampled;
+    bool profiled = evaluation_tracing && sampled;
+    uint64_t start_time = timed ? current_nanoseconds() : 0;
+    uint64_t step_start = profiled ? current_cycles() : 0;
+
+    if (profiled)
+    {
+        statistics.profiled_evaluations++;
+    }
 
-    // The number of pawns defending the white/black king
-    int white_defenders_count = 0;
-    int black_defenders_count = 0;
+    uint64_t position_key = the_board.get_position_key();
+    evaluation_cache_entry &cache_entry = evaluation_cache[position_key & (EVALUATION_CACHE_SIZE - 1)];
 
-    int defender_rank_white;
-    int defender_file_white;
-    int defender_rank_black;
-    int defender_file_black;
+    // A position found in the evaluation cache was neither a checkmate nor a stalemate, so we do not even need to
+    // look for a legal move
+    if constexpr (use_cache)
+    {
+        statistics.evaluation_cache_probes++;
 
-    chess_piece piece;
+        bool cache_hit = (cache_entry.position_key == position_key);
+        record_evaluation_cost(profiled, step_start, EVALUATION_CACHE_COST);
 
-    // Checking for pawns on every square surrounding the king
-    for (int step_rank = -1; step_rank <= 1; step_rank++)
-    {
-        for (int step_file = -1; step_file <= 1; step_file++)
+        if (cache_hit)
         {
-            if (step_rank == 0 && step_file == 0)
+            statistics.evaluations++;
+            statistics.evaluation_cache_hits++;
+
+            if (timed)
             {
-                continue;
+                statistics.evaluation_cache_hits_timed++;
+                statistics.evaluation_cache_hit_nanoseconds += current_nanoseconds() - start_time;
             }
 
-            defender_rank_white = white_king_tile.rank + step_rank;
-            defender_file_white = white_king_tile.file + step_file;
-            defender_rank_black = black_king_tile.rank + step_rank;
-            defender_file_black = black_king_tile.file + step_file;
+            return cache_entry.score;
+        }
+    }
 
-            if (defender_rank_white >= 0 && defender_rank_white < BOARD_SIZE && defender_file_white >= 0 && defender_file_white < BOARD_SIZE)
-            {
-                // Getting the piece
-                piece = the_board.get_piece_at(defender_rank_white, defender_file_white);
+    // Without any legal move, the player to move is either checkmated or stalemated. We stop at the first
+    // legal move found, as there is no need to know them all
+    bool legal_move_found = has_legal_move(the_board, player_color);
+    record_evaluation_cost(profiled, step_start, LEGAL_MOVE_COST);
 
-                // Checking if it is a white pawn defending the white king
-                if (piece.type == PAWN && piece.color == WHITE)
-                {
-                    white_defenders_count++;
-                }
-            }
+    if (!legal_move_found)
+    {
+        return in_check ? checkmated_score(player_color, ply) : DRAW_SCORE;
+    }
+
+    statistics.evaluations++;
 
-            if (defender_rank_black >= 0 && defender_rank_black < BOARD_SIZE && defender_file_black >= 0 && defender_file_black < BOARD_SIZE)
+    // The piece square score, which includes the material, is kept up to date by the board, so it costs nothing
+    int evaluation = piece_square_evaluation(the_board);
+    record_evaluation_cost(profiled, step_start, PIECE_SQUARE_COST);
+
+    if constexpr (use_material_hash)
+    {
+        const material_hash_entry &material = probe_material_hash(the_board);
+        record_evaluation_cost(profiled, step_start, MATERIAL_HASH_COST);
+
+        // Some endgames are better evaluated by their own functions, which know how to win them
+        if constexpr ((features & KNOWN_ENDGAME_FEATURE) != 0)
+        {
+            if (material.endgame != GENERIC_ENDGAME)
             {
-                // Getting the piece
-                piece = the_board.get_piece_at(defender_rank_black, defender_file_black);
+                int endgame_evaluation = known_endgame_evaluation(the_board, material);
+                record_evaluation_cost(profiled, step_start, MATERIAL_HASH_COST);
 
-                // Checking if it is a black pawn defending the black king
-                if (piece.type == PAWN && piece.color == BLACK)
-                {
-                    black_defenders_count++;
-                }
+                return endgame_evaluation;
             }
         }
-    }
 
-    return (white_defenders_count - black_defenders_count) * (int)PAWN_DEFENDER_SCORE;
-}
+        // The material imbalance is found in the material hash table
+        if constexpr ((features & MATERIAL_IMBALANCE_FEATURE) != 0)
+        {
+            evaluation += taper_score(material.imbalance, determine_game_phase(the_board));
+            record_evaluation_cost(profiled, step_start, MATERIAL_HASH_COST);
+        }
+    }
 
-int pawn_structure_evaluation(const board &the_board)
-{
-    int evaluation = 0;
-    int white_pawns; // number of white pawns on a file
-    int black_pawns; // number of black pawns on a file
-    chess_piece piece;
+    if constexpr ((features & POSITIONAL_EVALUATION_FEATURES) != 0)
+    {
+        // If the score is too far outside the window for the other terms to matter, we do not compute them
+        if (evaluation - LAZY_EVALUATION_MARGIN >= beta || evaluation + LAZY_EVALUATION_MARGIN <= alpha)
+        {
+            statistics.lazy_evaluations++;
+            return evaluation;
+        }
 
-    int white_pawns_on_file[BOARD_SIZE]; // Used to store the number of white pawns found on each file
-    int black_pawns_on_file[BOARD_SIZE]; // Used to store the number of black pawns found on each file
+        // The attacked tiles are computed once and shared by all the heuristic functions which need them
+        attack_info attacks;
 
-    int isolated_white_pawns_count = 0; // Number of isolated white pawns
-    int isolated_black_pawns_count = 0; // Number of isolated black pawns
+        if constexpr (use_attacks)
+        {
+            attacks = compute_attack_info(the_board);
+            record_evaluation_cost(profiled, step_start, ATTACK_INFO_COST);
+        }
 
-    for (int file = 0; file < BOARD_SIZE; file++)
-    {
-        white_pawns = 0;
-        black_pawns = 0;
+        // The material and positional weights are already applied to the piece square score. The other terms are
+        // weighted in fixed-point and divided once. Integer division rounds towards zero for both colors alike, so
+        // a position and its mirror image get exactly opposite evaluations. The terms left out are not computed
+        int weighted_terms = 0;
 
-        // Getting the number of white pawns and black pawns on the file
-        for (int rank = 0; rank < BOARD_SIZE; rank++)
+        if constexpr ((features & MOBILITY_FEATURE) != 0)
         {
-            piece = the_board.get_piece_at(rank, file);
+            weighted_terms += parameters.scalars[MOBILITY_WEIGHT_PARAMETER] * mobility_evaluation(attacks);
+            record_evaluation_cost(profiled, step_start, MOBILITY_COST);
+        }
 
-            if (piece.type == PAWN)
-            {
-                if (piece.color == WHITE)
-                {
-                    white_pawns++;
-                }
-                else if (piece.color == BLACK)
-                {
-                    black_pawns++;
-                }
-            }
+        if constexpr ((features & KING_SAFETY_FEATURE) != 0)
+        {
+            weighted_terms += parameters.scalars[KING_SAFETY_WEIGHT_PARAMETER] * king_safety_evaluation(the_board, attacks);
+            record_evaluation_cost(profiled, step_start, KING_SAFETY_COST);
         }
 
-        // Calculating the penalty for each file and adjusting the evaluation //
+        if constexpr ((features & PAWN_STRUCTURE_FEATURE) != 0)
+        {
+            weighted_terms += parameters.scalars[PAWN_STRUCTURE_WEIGHT_PARAMETER] * pawn_structure_evaluation(the_board);
+            record_evaluation_cost(profiled, step_start, PAWN_STRUCTURE_COST);
+        }
 
-        if (white_pawns > 1)
+        if constexpr ((features & CENTER_CONTROL_FEATURE) != 0)
         {
-            evaluation -= DOUBLE_PAWN_PENALTY * (white_pawns - 1);
+            weighted_terms += parameters.scalars[CENTER_CONTROL_WEIGHT_PARAMETER] * center_control_evaluation(the_board, attacks);
+            record_evaluation_cost(profiled, step_start, CENTER_CONTROL_COST);
         }
 
-        if (black_pawns > 1)
+        if constexpr ((features & THREAT_FEATURE) != 0)
         {
-            evaluation += DOUBLE_PAWN_PENALTY * (black_pawns - 1);
+            weighted_terms += parameters.scalars[THREAT_WEIGHT_PARAMETER] * threat_evaluation(the_board, attacks);
+            record_evaluation_cost(profiled, step_start, THREAT_COST);
         }
 
-        white_pawns_on_file[file] = white_pawns;
-        black_pawns_on_file[file] = black_pawns;
+        evaluation += weighted_terms / EVALUATION_WEIGHT_SCALE;
     }
 
-    // Looking for isolated pawns and counting them
-    for (int file = 0; file < BOARD_SIZE; file++)
+    // Caching the evaluation, unless it does not fit in the entry
+    if constexpr (use_cache)
     {
-        if (file == 0)
+        if (evaluation >= INT16_MIN && evaluation <= INT16_MAX)
         {
-            if (white_pawns_on_file[file] >= 1 && white_pawns_on_file[file + 1] == 0)
-            {
-                isolated_white_pawns_count++;
-            }
-
-            if (black_pawns_on_file[file] >= 1 && black_pawns_on_file[file + 1] == 0)
-            {
-                isolated_black_pawns_count++;
-            }
+            cache_entry.position_key = position_key;
+            cache_entry.score = (int16_t)evaluation;
         }
-        else if (file == BOARD_SIZE - 1)
-        {
-            if (white_pawns_on_file[file] >= 1 && white_pawns_on_file[file - 1] == 0)
-            {
-                isolated_white_pawns_count++;
-            }
 
-            if (black_pawns_on_file[file] >= 1 && black_pawns_on_file[file - 1] == 0)
-            {
-                isolated_black_pawns_count++;
-            }
+        if (timed)
+        {
+            statistics.evaluation_cache_misses_timed++;
+            statistics.evaluation_cache_miss_nanoseconds += current_nanoseconds() - start_time;
         }
-        else
+    }
+
+    return evaluation;
+}
+
+// The feature sets of the fast and full builds are available in every build, so that they can be compared
+template int evaluate_board_terms<FAST_EVALUATION_FEATURES>(board &, const int, piece_color, const bool, int, int);
+template int evaluate_board_terms<FULL_EVALUATION_FEATURES>(board &, const int, piece_color, const bool, int, int);
+
+void set_evaluation_tracing(bool enabled)
+{
+    evaluation_tracing = enabled;
+}
+
+bool evaluation_tracing_enabled()
+{
+    return evaluation_tracing;
+}
+
+evaluation_trace trace_evaluation(board &the_board)
+{
+    evaluation_trace trace;
+    int phase = determine_game_phase(the_board);
+    piece_color player_color = the_board.get_side_to_move();
+
+    trace.evaluation = evaluate_board_terms<ENGINE_EVALUATION_FEATURES>(the_board, 0, player_color, the_board.king_in_check(player_color),
+                                                                        -CHECKMATE_SCORE, CHECKMATE_SCORE);
+
+    // The piece square scores hold the weighted piece values, which are taken out to get the positional term
+    int packed_piece_square_scores[LAST_COLOR] = {};
+
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
         {
-            if (white_pawns_on_file[file] >= 1 && white_pawns_on_file[file - 1] == 0 && white_pawns_on_file[file + 1] == 0)
+            chess_piece piece = the_board.get_piece_at(rank, file);
+
+            if (piece.type == NONE)
             {
-                isolated_white_pawns_count++;
+                continue;
             }
 
-            if (black_pawns_on_file[file] >= 1 && black_pawns_on_file[file - 1] == 0 && black_pawns_on_file[file + 1] == 0)
+            int sign = (piece.color == WHITE) ? 1 : -1;
+            packed_piece_square_scores[piece.color] += sign * piece_square_value(piece, {rank, file});
+
+            if (piece.type != KING)
             {
-                isolated_black_pawns_count++;
+                trace.values[MATERIAL_TERM][piece.color] += weighted_score(PIECE_VALUE[piece.type], parameters.scalars[MATERIAL_WEIGHT_PARAMETER]);
             }
         }
     }
 
-    // Adjusting the evaluation for the isolated pawn penalty
-    evaluation -= ISOLATED_PAWN_PENALTY * (isolated_white_pawns_count);
-    evaluation += ISOLATED_PAWN_PENALTY * (isolated_black_pawns_count);
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        trace.values[POSITIONAL_TERM][color] = taper_score(packed_piece_square_scores[color], phase) - trace.values[MATERIAL_TERM][color];
+    }
 
-    return evaluation;
-}
+    if ((ENGINE_EVALUATION_FEATURES & KNOWN_ENDGAME_FEATURE) != 0)
+    {
+        trace.endgame = probe_material_hash(the_board).endgame;
+    }
 
-int center_control_evaluation(const board &the_board)
-{
-    int evaluation = 0;
-    chess_piece piece;
-    // Since a chess board will always have an even number of
-    // ranks and files, this formula will work
-    int middle_square = BOARD_SIZE / 2;
+    // The positional terms are computed for each player as evaluate_board does for both, without the lazy evaluation
+    attack_info attacks = compute_attack_info(the_board);
+
+    for (int color = FIRST_COLOR; color < LAST_COLOR; color++)
+    {
+        piece_color own_color = (piece_color)color;
+        piece_color enemy_color = (own_color == WHITE) ? BLACK : WHITE;
+        uint64_t own_pawns = the_board.get_piece_bitboard(own_color, PAWN);
+        uint64_t enemy_pawns = the_board.get_piece_bitboard(enemy_color, PAWN);
+        int (&values)[EVALUATION_TERM_COUNT][LAST_COLOR] = trace.values;
+
+        if ((ENGINE_EVALUATION_FEATURES & MATERIAL_IMBALANCE_FEATURE) != 0)
+        {
+            values[IMBALANCE_TERM][color] = taper_score(material_imbalance_score(the_board, own_color), phase);
+        }
 
-    // Checking for pieces placed on the central squares
-    for (int rank = middle_square - 1; rank <= middle_square; rank++)
-    {
-        for (int file = middle_square - 1; file <= middle_square; file++)
+        if ((ENGINE_EVALUATION_FEATURES & MOBILITY_FEATURE) != 0)
         {
-            piece = the_board.get_piece_at(rank, file);
+            values[MOBILITY_TERM][color] = weighted_score(attacks.mobility[color], parameters.scalars[MOBILITY_WEIGHT_PARAMETER]);
+        }
 
-            if (piece.type == NONE)
-            {
-                continue;
-            }
+        if ((ENGINE_EVALUATION_FEATURES & KING_SAFETY_FEATURE) != 0)
+        {
+            values[KING_SAFETY_TERM][color] = weighted_score(taper_score(king_safety_score(the_board, attacks, own_color), phase),
+                                                             parameters.scalars[KING_SAFETY_WEIGHT_PARAMETER]);
+        }
+
+        if ((ENGINE_EVALUATION_FEATURES & PAWN_STRUCTURE_FEATURE) != 0)
+        {
+            values[PAWN_STRUCTURE_TERM][color] = weighted_score(taper_score(pawn_structure_score(own_pawns, enemy_pawns, own_color), phase),
+                                                                parameters.scalars[PAWN_STRUCTURE_WEIGHT_PARAMETER]);
+        }
 
-            int score = CENTER_CONTROL_BONUS[piece.type];
+        if ((ENGINE_EVALUATION_FEATURES & CENTER_CONTROL_FEATURE) != 0)
+        {
+            values[CENTER_CONTROL_TERM][color] = weighted_score(center_control_score(the_board, attacks, own_color),
+                                                                parameters.scalars[CENTER_CONTROL_WEIGHT_PARAMETER]);
+        }
 
-            // Adjusting the evaluation based on piece color
-            evaluation += (piece.color == WHITE ? score : -score);
+        if ((ENGINE_EVALUATION_FEATURES & THREAT_FEATURE) != 0)
+        {
+            values[THREAT_TERM][color] = weighted_score(threat_score(the_board, attacks, own_color), parameters.scalars[THREAT_WEIGHT_PARAMETER]);
         }
     }
 
-    return evaluation;
+    return trace;
 }
 
-int evaluate_board(board &the_board, const int &depth)
+// Names of the evaluation terms and of the evaluation steps in the logs
+static const char *const EVALUATION_TERM_NAMES[EVALUATION_TERM_COUNT] = {"Material", "Positional", "Imbalance", "Mobility",
+                                                                         "King safety", "Pawn structure", "Center control", "Threats"};
+static const char *const EVALUATION_COST_NAMES[EVALUATION_COST_COUNT] = {"Cache probe", "Legal move", "Piece square", "Material hash",
+                                                                         "Attack info", "Mobility", "King safety", "Pawn structure",
+                                                                         "Center control", "Threats"};
+
+void log_evaluation_trace(board &the_board)
 {
-    // If white is checkmated, this is ideal for minimizing player
-    if (the_board.checkmate_or_stalemate(WHITE, false))
-    {
-        return -100000 + (MINIMAX_DEPTH - depth); // We add depth so that the AI chooses shortest path to checkmate
-    }
+    evaluation_trace trace = trace_evaluation(the_board);
+
+    SDL_Log("%-16s %8s %8s %8s", "Term", "White", "Black", "Total");
 
-    // If black is checkmated, this is ideal for maximizing player
-    if (the_board.checkmate_or_stalemate(BLACK, false))
+    for (int term = 0; term < EVALUATION_TERM_COUNT; term++)
     {
-        return 100000 - (MINIMAX_DEPTH - depth); // We substract depth so that the AI chooses shortest path to checkmate
+        int white_value = trace.values[term][WHITE];
+        int black_value = trace.values[term][BLACK];
+
+        SDL_Log("%-16s %8d %8d %8d", EVALUATION_TERM_NAMES[term], white_value, black_value, white_value - black_value);
     }
 
-    // Checking for stalemate
-    if (the_board.checkmate_or_stalemate(WHITE, true) || the_board.checkmate_or_stalemate(BLACK, true))
+    if (trace.endgame != GENERIC_ENDGAME)
     {
-        return 0;
+        SDL_Log("Known endgame : the evaluation comes from its own function instead of the terms");
     }
 
-    int material_score = 0;
-    int positional_score = 0;
-    int mobility_score = 0;
-    int king_safety_score = 0;
-    int pawn_structure_score = 0;
-    int center_control_score = 0;
-
-    // Uncomment any of the other heuristic functions that you may want to use //
-
-    material_score = material_evaluation(the_board);
-    positional_score = positional_evaluation(the_board);
-    // mobility_score = mobility_evaluation(the_board);
-    // king_safety_score = king_safety_evaluation(the_board);
-    // pawn_structure_score = pawn_structure_evaluation(the_board);
-    // center_control_score = center_control_evaluation(the_board);
-
-    // We may implement dynamic weights depending on the game phase as a later iteration :)))
-    double final_heuristic_value = ((int)MATERIAL_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * material_score +
-                                   ((int)POSITIONAL_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * positional_score +
-                                   ((int)MOBILITY_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * mobility_score +
-                                   ((int)KING_SAFETY_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * king_safety_score +
-                                   ((int)PAWN_STRUCTURE_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * pawn_structure_score +
-                                   ((int)CENTER_CONTROL_EVALUATION_WEIGHT_PERCENTAGE / 100.0) * center_control_score;
-
-    return (int)final_heuristic_value;
+    SDL_Log("%-16s %26d", "Evaluation", trace.evaluation);
 }
 
 vector<square> possible_bishop_moves(const square &start_square, const int max_displacement)
@@ -1682,7 +3524,187 @@ vector<square> generate_possible_destination_squares(const square &start_square,
     return possible_destination_squares;
 }
 
-vector<move> generate_legal_moves(board &the_board, piece_color player_color)
+bool has_legal_move(board &the_board, piece_color player_color)
+{
+    for (int start_rank = 0; start_rank < BOARD_SIZE; start_rank++)
+    {
+        for (int start_file = 0; start_file < BOARD_SIZE; start_file++)
+        {
+            chess_piece piece = the_board.get_piece_at(start_rank, start_file);
+
+            // If the tile has no piece or the piece does not belong to the player, skip the iteration
+            if (piece.type == NONE || piece.color != player_color)
+            {
+                continue;
+            }
+
+            square start_square = {start_rank, start_file};
+            vector<square> possible_piece_destinations = generate_possible_destination_squares(start_square, piece);
+
+            // The first legal move found is enough
+            for (int index = 0; index < possible_piece_destinations.size(); index++)
+            {
+                if (is_legal_move(the_board, {start_square, possible_piece_destinations[index]}, false))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool is_capture_move(const board &the_board, const move &current_move)
+{
+    chess_piece piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
+    chess_piece target_piece = the_board.get_piece_at(current_move.to.rank, current_move.to.file);
+
+    // A pawn moving diagonally onto an empty square is an en passant capture
+    return target_piece.type != NONE || (piece.type == PAWN && abs(current_move.to.file - current_move.from.file) == 1);
+}
+
+bool capture_wins_material(const board &the_board, const move &current_move)
+{
+    chess_piece piece = the_board.get_piece_at(current_move.from.rank, current_move.from.file);
+    chess_piece target_piece = the_board.get_piece_at(current_move.to.rank, current_move.to.file);
+
+    // The only piece captured by an en passant capture is a pawn
+    piece_type captured_type = (target_piece.type == NONE) ? PAWN : target_piece.type;
+
+    if (PIECE_VALUE[captured_type] > PIECE_VALUE[piece.type])
+    {
+        return true;
+    }
+
+    // Otherwise the capture only wins material if the capturing piece cannot be taken back
+    return !the_board.is_square_attacked(current_move.to, (piece.color == WHITE) ? BLACK : WHITE);
+}
+
+/**
+ * @brief struct used to remember which move was played at each ply of the search, so that the move ordering
+ * knows which moves led to the position being searched
+ */
+struct search_stack_entry
+{
+    chess_piece moved_piece; // The piece moved
+    move move_made;          // The move made
+};
+
+// Moves played at each ply of the current line being searched
+static search_stack_entry search_stack[MAX_SEARCH_PLY];
+
+// Quiet move which refuted a move, indexed by the color and type of the piece moved and its destination square
+static move counter_moves[LAST_COLOR][TYPE_OF_PIECE_COUNT][BOARD_SIZE * BOARD_SIZE];
+
+// Continuation history, indexed by the color and type of the piece moved, its destination square, then the type of
+// the piece moving now and its destination square. The first table follows the move played one ply earlier and the
+// second table the move played two plies earlier.
+static int continuation_history[2][LAST_COLOR][TYPE_OF_PIECE_COUNT][BOARD_SIZE * BOARD_SIZE][TYPE_OF_PIECE_COUNT][BOARD_SIZE * BOARD_SIZE];
+
+void order_quiet_moves(const board &the_board, vector<move> &quiet_moves, int ply)
+{
+    if (ply < 1 || quiet_moves.size() < 2)
+    {
+        return;
+    }
+
+    const search_stack_entry &previous_move = search_stack[ply - 1];
+    int previous_to = previous_move.move_made.to.rank * BOARD_SIZE + previous_move.move_made.to.file;
+    move counter_move = counter_moves[previous_move.moved_piece.color][previous_move.moved_piece.type][previous_to];
+
+    // Scoring each quiet move once before sorting
+    vector<int> scores(quiet_moves.size());
+    vector<int> order(quiet_moves.size());
+
+    for (int index = 0; index < quiet_moves.size(); index++)
+    {
+        const move &quiet_move = quiet_moves[index];
+        piece_type type_of_piece = the_board.get_piece_at(quiet_move.from.rank, quiet_move.from.file).type;
+        int to = quiet_move.to.rank * BOARD_SIZE + quiet_move.to.file;
+
+        scores[index] = continuation_history[0][previous_move.moved_piece.color][previous_move.moved_piece.type][previous_to][type_of_piece][to];
+
+        if (ply >= 2)
+        {
+            const search_stack_entry &second_previous_move = search_stack[ply - 2];
+            int second_previous_to = second_previous_move.move_made.to.rank * BOARD_SIZE + second_previous_move.move_made.to.file;
+
+            scores[index] += continuation_history[1][second_previous_move.moved_piece.color][second_previous_move.moved_piece.type][second_previous_to][type_of_piece][to];
+        }
+
+        if (quiet_move == counter_move)
+        {
+            scores[index] += COUNTERMOVE_BONUS;
+        }
+
+        order[index] = index;
+    }
+
+    // Stable sort so that moves without any history keep the order in which they were found on the board
+    stable_sort(order.begin(), order.end(), [&](int first, int second)
+                { return scores[first] > scores[second]; });
+
+    vector<move> sorted_moves(quiet_moves.size());
+
+    for (int index = 0; index < order.size(); index++)
+    {
+        sorted_moves[index] = quiet_moves[order[index]];
+    }
+
+    quiet_moves = sorted_moves;
+}
+
+void update_quiet_move_history(const board &the_board, const vector<move> &legal_moves, int cutoff_index, int depth, int ply)
+{
+    // Captures are ordered by what they capture, so only quiet moves are recorded
+    if (ply < 1 || is_capture_move(the_board, legal_moves[cutoff_index]))
+    {
+        return;
+    }
+
+    const search_stack_entry &previous_move = search_stack[ply - 1];
+    int previous_to = previous_move.move_made.to.rank * BOARD_SIZE + previous_move.move_made.to.file;
+
+    counter_moves[previous_move.moved_piece.color][previous_move.moved_piece.type][previous_to] = legal_moves[cutoff_index];
+
+    // Deeper cutoffs are worth more as they save more work
+    int bonus = min(depth * depth, HISTORY_MAX / 4);
+
+    // Applies the bonus (or the penalty if negative) to a history entry. The more extreme the entry already is,
+    // the smaller the change, so scores stay within HISTORY_MAX and old results fade away
+    auto update_entry = [bonus](int &entry, bool cutoff)
+    {
+        int change = cutoff ? bonus : -bonus;
+        entry += change - entry * bonus / HISTORY_MAX;
+    };
+
+    for (int index = 0; index <= cutoff_index; index++)
+    {
+        const move &quiet_move = legal_moves[index];
+
+        // Captures searched before the cutoff move do not take part in the quiet move ordering
+        if (index != cutoff_index && is_capture_move(the_board, quiet_move))
+        {
+            continue;
+        }
+
+        piece_type type_of_piece = the_board.get_piece_at(quiet_move.from.rank, quiet_move.from.file).type;
+        int to = quiet_move.to.rank * BOARD_SIZE + quiet_move.to.file;
+
+        update_entry(continuation_history[0][previous_move.moved_piece.color][previous_move.moved_piece.type][previous_to][type_of_piece][to], index == cutoff_index);
+
+        if (ply >= 2)
+        {
+            const search_stack_entry &second_previous_move = search_stack[ply - 2];
+            int second_previous_to = second_previous_move.move_made.to.rank * BOARD_SIZE + second_previous_move.move_made.to.file;
+
+            update_entry(continuation_history[1][second_previous_move.moved_piece.color][second_previous_move.moved_piece.type][second_previous_to][type_of_piece][to], index == cutoff_index);
+        }
+    }
+}
+
+vector<move> generate_legal_moves(board &the_board, piece_color player_color, int ply)
 {
     chess_piece piece;
     vector<move> legal_moves = {};
@@ -1722,9 +3744,8 @@ vector<move> generate_legal_moves(board &the_board, piece_color player_color)
                 // Check if the move is legal
                 if (is_legal_move(the_board, try_move, false))
                 {
-                    chess_piece target_piece = the_board.get_piece_at(end_square.rank, end_square.file);
                     // Checking if it is a capture move
-                    if (target_piece.type != NONE || (piece.type == PAWN && abs(end_square.file - start_square.file) == 1))
+                    if (is_capture_move(the_board, try_move))
                     {
                         capture_moves.push_back(try_move);
                         continue;
@@ -1749,6 +3770,12 @@ vector<move> generate_legal_moves(board &the_board, piece_color player_color)
         }
     }
 
+    // Sorting the quiet moves using what the search learnt about them
+    if (ply != NO_SEARCH_PLY)
+    {
+        order_quiet_moves(the_board, quiet_moves, ply);
+    }
+
     // Ordering legal moves in the order : capture -> check -> quiet
 
     // Adding the capture moves to legal moves
@@ -1861,27 +3888,199 @@ void unpromote_pawn_from_queen(board &the_board, const move &move_made, const pi
     }
 }
 
-int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_player)
+int search_move(board &the_board, const move &move_made, int depth, int alpha, int beta, bool maximizing_player, int ply)
+{
+    piece_color player_color = maximizing_player ? WHITE : BLACK;
+    chess_piece moved_piece = the_board.get_piece_at(move_made.from.rank, move_made.from.file);
+
+    // Remembering the move for the move ordering of the positions below it
+    search_stack[ply] = {moved_piece, move_made};
+
+    // Making the move on the board and promoting the pawn if it reached a promotion square
+    the_board.move_piece(move_made);
+    bool pawn_promoted = promote_pawn_to_queen(the_board, moved_piece, move_made, player_color);
+
+    // Evaluating the board state from the point of view of the other player
+    int evaluation = minimax(the_board, depth, alpha, beta, !maximizing_player, ply + 1);
+
+    // Undoing the pawn promotion and the move
+    if (pawn_promoted)
+    {
+        unpromote_pawn_from_queen(the_board, move_made, player_color);
+    }
+
+    the_board.unmove_piece();
+
+    return evaluation;
+}
+
+bool is_singular_move(board &the_board, const vector<move> &legal_moves, int depth, int candidate_evaluation, bool maximizing_player, int ply)
+{
+    // The other moves are only looked at half as deep as the position itself
+    int singular_depth = depth / 2;
+
+    // White needs every other move to stay below the bound while black needs them to stay above it
+    int singular_bound = maximizing_player ? candidate_evaluation - SINGULAR_EXTENSION_MARGIN : candidate_evaluation + SINGULAR_EXTENSION_MARGIN;
+
+    // Every move but the candidate is searched with a null window around the bound, as we only need to
+    // know which side of the bound it falls on
+    for (int index = 1; index < legal_moves.size(); index++)
+    {
+        if (maximizing_player)
+        {
+            if (search_move(the_board, legal_moves[index], singular_depth - 1, singular_bound - 1, singular_bound, true, ply) >= singular_bound)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (search_move(the_board, legal_moves[index], singular_depth - 1, singular_bound, singular_bound + 1, false, ply) <= singular_bound)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Best move found by minimax for the position searched at each ply. Internal iterative deepening reads
+// it back after a reduced depth search to know which move to try first.
+static move best_move_at_ply[MAX_SEARCH_PLY];
+
+int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_player, int ply)
 {
-    if (depth == 0 || the_board.checkmate_or_stalemate(maximizing_player ? WHITE : BLACK, false) || the_board.checkmate_or_stalemate(maximizing_player ? WHITE : BLACK, true))
+    piece_color player_color = maximizing_player ? WHITE : BLACK;
+
+    statistics.nodes++;
+
+    // A position met before in the line being searched or in the game is scored as a draw, as the players can
+    // repeat moves forever. There is no point searching the same cycle again.
+    if (the_board.get_halfmove_clock() >= FIFTY_MOVE_RULE_PLIES || the_board.repetition_count() >= 1)
+    {
+        return DRAW_SCORE;
+    }
+
+    // Neither player can checkmate, so there is nothing left to search
+    if (insufficient_material(the_board))
     {
-        int eval = evaluate_board(the_board, depth);
-        SDL_Log("Eval at depth %d is %d", depth, eval);
-        return eval;
+        return DRAW_SCORE;
+    }
+
+    // Mate distance pruning. The best the player to move can hope for is to checkmate on the next ply and
+    // the worst is to be checkmated right now. If alpha or beta already hold a shorter mate than that,
+    // nothing in this subtree can change the result, so we do not search it.
+    int mate_lower_bound = -CHECKMATE_SCORE + ply + (maximizing_player ? 0 : 1);
+    int mate_upper_bound = CHECKMATE_SCORE - ply - (maximizing_player ? 1 : 0);
+
+    if (mate_lower_bound >= beta)
+    {
+        return mate_lower_bound;
+    }
+
+    if (mate_upper_bound <= alpha)
+    {
+        return mate_upper_bound;
+    }
+
+    alpha = max(alpha, mate_lower_bound);
+    beta = min(beta, mate_upper_bound);
+
+    bool in_check = the_board.king_in_check(player_color);
+
+    // Check extension. A player in check has very few replies, so we look one ply further to let
+    // forcing sequences resolve. The ply limit stops endless checks from blowing up the search.
+    if (ply < CHECK_EXTENSION_PLY_LIMIT && in_check)
+    {
+        depth++;
+    }
+
+    // Checkmate and stalemate are detected by evaluate_board at the leaves and by the empty move list below
+    if (depth == 0 || ply >= MAX_SEARCH_PLY - 1)
+    {
+        return evaluate_board(the_board, ply, player_color, in_check, alpha, beta);
     }
 
     // Get all possible legal moves for the player
-    vector<move> legal_moves = generate_legal_moves(the_board, (maximizing_player ? WHITE : BLACK));
+    vector<move> legal_moves = generate_legal_moves(the_board, player_color, ply);
 
-    // If no legal moves can be played, stop searching the tree and return the evaluation
+    // If no legal moves can be played, it is either checkmate or stalemate
     if (legal_moves.size() == 0)
     {
-        return evaluate_board(the_board, depth);
+        return in_check ? checkmated_score(player_color, ply) : DRAW_SCORE;
     }
 
-    // Flags used to keep track of whether a white pawn was promoted or a black pawn was promoted
-    bool white_pawn_promoted = false;
-    bool black_pawn_promoted = false;
+    // ProbCut. If a capture that wins material outright already beats beta by a wide margin in a shallow
+    // search, the full depth search would almost certainly fail high as well, so we cut straight away.
+    if (depth >= PROBCUT_DEPTH && !in_check && abs(maximizing_player ? beta : alpha) < CHECKMATE_SCORE - MAX_SEARCH_PLY)
+    {
+        int probcut_bound = maximizing_player ? beta + PROBCUT_MARGIN : alpha - PROBCUT_MARGIN;
+        int probcut_depth = depth - PROBCUT_DEPTH_REDUCTION;
+
+        // Captures are always at the front of the legal moves
+        for (int index = 0; index < legal_moves.size() && is_capture_move(the_board, legal_moves[index]); index++)
+        {
+            if (!capture_wins_material(the_board, legal_moves[index]))
+            {
+                continue;
+            }
+
+            if (maximizing_player)
+            {
+                int evaluation = search_move(the_board, legal_moves[index], probcut_depth - 1, probcut_bound - 1, probcut_bound, true, ply);
+
+                if (evaluation >= probcut_bound)
+                {
+                    return evaluation;
+                }
+            }
+            else
+            {
+                int evaluation = search_move(the_board, legal_moves[index], probcut_depth - 1, probcut_bound, probcut_bound + 1, false, ply);
+
+                if (evaluation <= probcut_bound)
+                {
+                    return evaluation;
+                }
+            }
+        }
+    }
+
+    // Flag used to know if the first move must be searched one ply deeper for being singular
+    bool singular_extension = false;
+
+    // Internal iterative deepening. Before paying for the full depth search, we search this same position
+    // at a reduced depth and move the best move it found to the front of the list, so that the full
+    // search starts with a good first move and prunes more. It is skipped in check as there are few replies.
+    if (depth >= IID_DEPTH_THRESHOLD && !in_check)
+    {
+        // The reduced depth search can return before its move loop, through mate distance pruning, ProbCut or a
+        // repetition. The best move of the ply is cleared so that a move left by a sibling position is not used
+        best_move_at_ply[ply] = {{-1, -1}, {-1, -1}};
+
+        int iid_evaluation = minimax(the_board, depth - IID_DEPTH_REDUCTION, alpha, beta, maximizing_player, ply);
+
+        auto iid_move = find(legal_moves.begin(), legal_moves.end(), best_move_at_ply[ply]);
+
+        if (iid_move != legal_moves.end())
+        {
+            rotate(legal_moves.begin(), iid_move, iid_move + 1);
+
+            // The evaluation only tells us how good the move is if it did not fail low, and mate scores
+            // are left alone as the mate will be found without the extension
+            bool iid_move_inside_window = maximizing_player ? (iid_evaluation > alpha) : (iid_evaluation < beta);
+
+            // Singular extension. If the reduced depth search says every other move is clearly worse than
+            // this one, the whole position depends on it, so it gets searched one ply deeper
+            if (depth >= SINGULAR_EXTENSION_DEPTH && ply < CHECK_EXTENSION_PLY_LIMIT && legal_moves.size() > 1 && iid_move_inside_window && abs(iid_evaluation) < CHECKMATE_SCORE - MAX_SEARCH_PLY)
+            {
+                singular_extension = is_singular_move(the_board, legal_moves, depth, iid_evaluation, maximizing_player, ply);
+            }
+        }
+    }
+
+    best_move_at_ply[ply] = legal_moves[0];
 
     if (maximizing_player)
     {
@@ -1891,31 +4090,23 @@ int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_pl
         for (int index = 0; index < legal_moves.size(); index++)
         {
             move move_made = legal_moves[index];
-            chess_piece moved_piece = the_board.get_piece_at(move_made.from.rank, move_made.from.file);
-            the_board.move_piece(move_made);
-
-            // Checking if there should be a pawn promotion and doing it if yes
-            white_pawn_promoted = automatic_white_pawn_promotion(the_board, moved_piece, move_made);
 
-            // Evaluating the board state
-            int evaluation = minimax(the_board, depth - 1, alpha, beta, false);
+            // Evaluating the board state. A singular first move is searched one ply deeper
+            int evaluation = search_move(the_board, move_made, depth - 1 + ((singular_extension && index == 0) ? 1 : 0), alpha, beta, true, ply);
 
-            // Undoing the pawn promotion
-            if (white_pawn_promoted)
+            if (evaluation > max_evaluation)
             {
-                undo_white_pawn_promotion(the_board, move_made);
-                white_pawn_promoted = false;
+                max_evaluation = evaluation;
+                best_move_at_ply[ply] = move_made;
             }
 
-            // Undoing the move
-            the_board.unmove_piece();
-
-            max_evaluation = max(max_evaluation, evaluation);
             alpha = max(alpha, evaluation);
 
             // Pruning
             if (beta <= alpha)
             {
+                // Remembering the refutation for the ordering of quiet moves
+                update_quiet_move_history(the_board, legal_moves, index, depth, ply);
                 break;
             }
         }
@@ -1929,33 +4120,23 @@ int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_pl
         for (int index = 0; index < legal_moves.size(); index++)
         {
             move move_made = legal_moves[index];
-            chess_piece moved_piece = the_board.get_piece_at(move_made.from.rank, move_made.from.file);
-
-            // Moving the chess piece
-            the_board.move_piece(move_made);
 
-            // Checking if there should be a pawn promotion and doing it if yes
-            black_pawn_promoted = automatic_black_pawn_promotion(the_board, moved_piece, move_made);
+            // Evaluating the board state. A singular first move is searched one ply deeper
+            int evaluation = search_move(the_board, move_made, depth - 1 + ((singular_extension && index == 0) ? 1 : 0), alpha, beta, false, ply);
 
-            // Evaluating the board state
-            int evaluation = minimax(the_board, depth - 1, alpha, beta, true);
-
-            // Undoing the pawn promotion
-            if (black_pawn_promoted)
+            if (evaluation < min_evaluation)
             {
-                undo_black_pawn_promotion(the_board, move_made);
-                black_pawn_promoted = false;
+                min_evaluation = evaluation;
+                best_move_at_ply[ply] = move_made;
             }
 
-            // Undoing the move
-            the_board.unmove_piece();
-
-            min_evaluation = min(min_evaluation, evaluation);
             beta = min(beta, evaluation);
 
             // Pruning
             if (beta <= alpha)
             {
+                // Remembering the refutation for the ordering of quiet moves
+                update_quiet_move_history(the_board, legal_moves, index, depth, ply);
                 break;
             }
         }
@@ -1964,6 +4145,63 @@ int minimax(board &the_board, int depth, int alpha, int beta, bool maximizing_pl
     }
 }
 
+const search_statistics &get_search_statistics()
+{
+    return statistics;
+}
+
+void reset_search_statistics()
+{
+    statistics = {};
+}
+
+void log_search_statistics()
+{
+    double hit_rate = 0;
+    double speedup = 1;
+
+    if (statistics.evaluation_cache_probes > 0)
+    {
+        hit_rate = 100.0 * statistics.evaluation_cache_hits / statistics.evaluation_cache_probes;
+    }
+
+    // Estimating how long the evaluations would have taken without the cache, with each hit costing as much as a miss
+    if (statistics.evaluation_cache_misses_timed > 0)
+    {
+        double average_miss_nanoseconds = (double)statistics.evaluation_cache_miss_nanoseconds / statistics.evaluation_cache_misses_timed;
+        double time_with_cache = statistics.evaluation_cache_miss_nanoseconds + statistics.evaluation_cache_hit_nanoseconds;
+        double time_without_cache = statistics.evaluation_cache_miss_nanoseconds + average_miss_nanoseconds * statistics.evaluation_cache_hits_timed;
+
+        speedup = time_without_cache / time_with_cache;
+    }
+
+    SDL_Log("Searched %llu nodes, %llu evaluations (%llu lazy)", (unsigned long long)statistics.nodes,
+            (unsigned long long)statistics.evaluations, (unsigned long long)statistics.lazy_evaluations);
+    SDL_Log("Evaluation cache hit rate : %.1f%%, estimated evaluation speedup : %.2fx", hit_rate, speedup);
+
+    // In trace mode, the average cost of each evaluation step is logged. Steps skipped by an evaluation, because of a
+    // cache hit or the lazy evaluation, count as free for it, so the averages add up to the cost of an evaluation
+    if (statistics.profiled_evaluations > 0)
+    {
+        uint64_t total_cycles = 0;
+
+        for (int cost = 0; cost < EVALUATION_COST_COUNT; cost++)
+        {
+            total_cycles += statistics.evaluation_cycles[cost];
+        }
+
+        SDL_Log("Sampled %llu evaluations, %.0f cycles per evaluation", (unsigned long long)statistics.profiled_evaluations,
+                (double)total_cycles / statistics.profiled_evaluations);
+
+        for (int cost = 0; cost < EVALUATION_COST_COUNT; cost++)
+        {
+            SDL_Log("%-16s %10.1f cycles %6.1f%%", EVALUATION_COST_NAMES[cost],
+                    (double)statistics.evaluation_cycles[cost] / statistics.profiled_evaluations,
+                    total_cycles > 0 ? 100.0 * statistics.evaluation_cycles[cost] / total_cycles : 0.0);
+        }
+    }
+}
+
 move find_best_move(board &the_board, int depth, piece_color player_color)
 {
     vector<move> possible_legal_moves = generate_legal_moves(the_board, player_color);
@@ -1972,6 +4210,23 @@ move find_best_move(board &the_board, int depth, piece_color player_color)
     int alpha = -1000000;
     int beta = 1000000;
 
+    // In trace mode, the terms of the evaluation of the root position are logged before the search
+    if (evaluation_tracing)
+    {
+        log_evaluation_trace(the_board);
+    }
+
+    // The statistics are logged at the end of each search
+    reset_search_statistics();
+
+#ifndef NDEBUG
+    // Everything the board keeps up to date is computed again from scratch at the root, to catch update bugs
+    if (!the_board.verify_incremental_state())
+    {
+        SDL_Log("The incremental state of the board does not match the board at the root of the search");
+    }
+#endif
+
     // If there are no legal moves to play, just return best_move to signify either
     // checkmate or stalemate
     // if (possible_legal_moves.size() == 0)
@@ -1986,18 +4241,9 @@ move find_best_move(board &the_board, int depth, piece_color player_color)
     for (int index = 0; index < possible_legal_moves.size(); index++)
     {
         move move_made = possible_legal_moves[index];
-        chess_piece moved_piece = the_board.get_piece_at(move_made.from.rank, move_made.from.file);
-        bool pawn_promoted = false;
-
-        // Making the move on the board
-        the_board.move_piece(move_made);
-
-        // Check if the moved piece is a pawn and if it lands on a promotion square. If yes,
-        // promote it to a queen
-        pawn_promoted = promote_pawn_to_queen(the_board, moved_piece, move_made, player_color);
 
-        // Evaluating the board state
-        evaluation = minimax(the_board, depth - 1, alpha, beta, (player_color == WHITE ? false : true));
+        // Evaluating the board state after the move
+        evaluation = search_move(the_board, move_made, depth - 1, alpha, beta, (player_color == WHITE), 0);
 
         // Adjusting alpha and/or at top level
         if (player_color == WHITE)
@@ -2009,15 +4255,6 @@ move find_best_move(board &the_board, int depth, piece_color player_color)
             beta = min(beta, evaluation);
         }
 
-        // Undoing the pawn promotion if it was promoted
-        if (pawn_promoted)
-        {
-            unpromote_pawn_from_queen(the_board, move_made, player_color);
-        }
-
-        // Undoing the move
-        the_board.unmove_piece();
-
         // Adjusting the best_value and best move that can be made
         if ((player_color == WHITE && evaluation > best_value) || (player_color == BLACK && evaluation < best_value))
         {
@@ -2027,6 +4264,7 @@ move find_best_move(board &the_board, int depth, piece_color player_color)
     }
 
     SDL_Log("Best evaluation is : %d", best_value);
+    log_search_statistics();
 
     return best_move;
 }
@@ -0,0 +1,452 @@
+#include "Chess-Model.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NNUE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit vector instructions in the functions allowed to use them, so the program still runs on
+// processors without them. MSVC emits any intrinsic it is given
+#if defined(__GNUC__)
+#define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+#define NNUE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define NNUE_TARGET_AVX2
+#define NNUE_TARGET_SSE41
+#endif
+
+using std::ifstream, std::vector, std::clamp;
+
+/**
+ * @brief struct holding the weights and biases of the neural network, in the order of the network file
+ */
+struct nnue_network
+{
+    vector<int16_t> input_biases;   // NNUE_HIDDEN_SIZE biases of the first layer
+    vector<int16_t> input_weights;  // NNUE_HIDDEN_SIZE weights for each of the NNUE_INPUT_SIZE inputs
+    vector<int32_t> hidden1_biases; // NNUE_LAYER_SIZE biases of the second layer
+    vector<int8_t> hidden1_weights; // 2 * NNUE_HIDDEN_SIZE weights for each neuron of the second layer
+    vector<int32_t> hidden2_biases; // NNUE_LAYER_SIZE biases of the third layer
+    vector<int8_t> hidden2_weights; // NNUE_LAYER_SIZE weights for each neuron of the third layer
+    int32_t output_bias = 0;        // Bias of the output neuron
+    vector<int8_t> output_weights;  // NNUE_LAYER_SIZE weights of the output neuron
+};
+
+/**
+ * @brief struct holding the kernels of one instruction set. The sizes of the vectors they work on are multiples of
+ * 32, so no kernel needs to handle leftover values.
+ */
+struct nnue_kernels
+{
+    void (*add)(int16_t *values, const int16_t *weights);                  // Adds NNUE_HIDDEN_SIZE weights to an accumulator perspective
+    void (*subtract)(int16_t *values, const int16_t *weights);             // Subtracts NNUE_HIDDEN_SIZE weights from an accumulator perspective
+    void (*activate)(const int16_t *values, uint8_t *output);             // Clips NNUE_HIDDEN_SIZE values between 0 and NNUE_ACTIVATION_MAX
+    int32_t (*dot_product)(const uint8_t *input, const int8_t *weights, int size); // Dot product of activations and weights
+};
+
+static nnue_network network;                           // The neural network, loaded once before any search
+static bool network_loaded = false;                    // Flag used to know if a network was loaded
+static evaluator_type current_evaluator = CLASSIC_EVALUATOR; // Evaluator of the leaves of the search
+
+/* SCALAR KERNELS */
+
+static void scalar_add(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron++)
+    {
+        values[neuron] += weights[neuron];
+    }
+}
+
+static void scalar_subtract(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron++)
+    {
+        values[neuron] -= weights[neuron];
+    }
+}
+
+static void scalar_activate(const int16_t *values, uint8_t *output)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron++)
+    {
+        output[neuron] = (uint8_t)clamp((int)values[neuron], 0, NNUE_ACTIVATION_MAX);
+    }
+}
+
+static int32_t scalar_dot_product(const uint8_t *input, const int8_t *weights, int size)
+{
+    int32_t sum = 0;
+
+    for (int index = 0; index < size; index++)
+    {
+        sum += input[index] * weights[index];
+    }
+
+    return sum;
+}
+
+#ifdef NNUE_X86
+
+/* SSE4.1 KERNELS */
+
+NNUE_TARGET_SSE41 static void sse41_add(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 8)
+    {
+        __m128i sum = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(values + neuron)), _mm_loadu_si128((const __m128i *)(weights + neuron)));
+        _mm_storeu_si128((__m128i *)(values + neuron), sum);
+    }
+}
+
+NNUE_TARGET_SSE41 static void sse41_subtract(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 8)
+    {
+        __m128i difference = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(values + neuron)), _mm_loadu_si128((const __m128i *)(weights + neuron)));
+        _mm_storeu_si128((__m128i *)(values + neuron), difference);
+    }
+}
+
+NNUE_TARGET_SSE41 static void sse41_activate(const int16_t *values, uint8_t *output)
+{
+    // Packing saturates the values between -128 and 127, and the maximum with 0 clips the negative ones
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 16)
+    {
+        __m128i low = _mm_loadu_si128((const __m128i *)(values + neuron));
+        __m128i high = _mm_loadu_si128((const __m128i *)(values + neuron + 8));
+        __m128i packed = _mm_max_epi8(_mm_packs_epi16(low, high), _mm_setzero_si128());
+        _mm_storeu_si128((__m128i *)(output + neuron), packed);
+    }
+}
+
+NNUE_TARGET_SSE41 static int32_t sse41_dot_product(const uint8_t *input, const int8_t *weights, int size)
+{
+    // Activations are at most NNUE_ACTIVATION_MAX, so the pairs of products summed by maddubs never saturate
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+
+    for (int index = 0; index < size; index += 16)
+    {
+        __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(input + index)), _mm_loadu_si128((const __m128i *)(weights + index)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum);
+}
+
+/* AVX2 KERNELS */
+
+NNUE_TARGET_AVX2 static void avx2_add(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 16)
+    {
+        __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(values + neuron)), _mm256_loadu_si256((const __m256i *)(weights + neuron)));
+        _mm256_storeu_si256((__m256i *)(values + neuron), sum);
+    }
+}
+
+NNUE_TARGET_AVX2 static void avx2_subtract(int16_t *values, const int16_t *weights)
+{
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 16)
+    {
+        __m256i difference = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(values + neuron)), _mm256_loadu_si256((const __m256i *)(weights + neuron)));
+        _mm256_storeu_si256((__m256i *)(values + neuron), difference);
+    }
+}
+
+NNUE_TARGET_AVX2 static void avx2_activate(const int16_t *values, uint8_t *output)
+{
+    // Packing works on each 128 bit half separately, so the 64 bit blocks are put back in order afterwards
+    for (int neuron = 0; neuron < NNUE_HIDDEN_SIZE; neuron += 32)
+    {
+        __m256i low = _mm256_loadu_si256((const __m256i *)(values + neuron));
+        __m256i high = _mm256_loadu_si256((const __m256i *)(values + neuron + 16));
+        __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), _mm256_setzero_si256());
+        _mm256_storeu_si256((__m256i *)(output + neuron), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+}
+
+NNUE_TARGET_AVX2 static int32_t avx2_dot_product(const uint8_t *input, const int8_t *weights, int size)
+{
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int index = 0; index < size; index += 32)
+    {
+        __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(input + index)), _mm256_loadu_si256((const __m256i *)(weights + index)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+
+    __m128i half_sum = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(half_sum);
+}
+
+#endif
+
+/**
+ * @brief The function finds the fastest instruction set supported by the processor and the operating system
+ *
+ * @return the instruction set
+ */
+static nnue_instruction_set supported_instruction_set()
+{
+#if defined(NNUE_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return NNUE_AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return NNUE_SSE41;
+    }
+#elif defined(NNUE_X86) && defined(_MSC_VER)
+    int registers[4];
+
+    __cpuid(registers, 0);
+    int highest_leaf = registers[0];
+
+    __cpuid(registers, 1);
+    bool sse41 = registers[2] & (1 << 19);
+
+    // AVX registers can only be used if the operating system saves them, which XGETBV tells
+    bool avx = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+
+    if (avx && highest_leaf >= 7)
+    {
+        __cpuidex(registers, 7, 0);
+        avx2 = registers[1] & (1 << 5);
+    }
+
+    if (avx2)
+    {
+        return NNUE_AVX2;
+    }
+
+    if (sse41)
+    {
+        return NNUE_SSE41;
+    }
+#endif
+
+    return NNUE_SCALAR;
+}
+
+/**
+ * @brief The function returns the kernels of an instruction set
+ *
+ * @param instruction_set is the instruction set
+ *
+ * @return the kernels
+ */
+static nnue_kernels kernels_for(nnue_instruction_set instruction_set)
+{
+#ifdef NNUE_X86
+    if (instruction_set == NNUE_AVX2)
+    {
+        return {avx2_add, avx2_subtract, avx2_activate, avx2_dot_product};
+    }
+
+    if (instruction_set == NNUE_SSE41)
+    {
+        return {sse41_add, sse41_subtract, sse41_activate, sse41_dot_product};
+    }
+#endif
+
+    return {scalar_add, scalar_subtract, scalar_activate, scalar_dot_product};
+}
+
+static const nnue_instruction_set best_instruction_set = supported_instruction_set(); // Fastest instruction set of the processor
+static nnue_instruction_set current_instruction_set = best_instruction_set;           // Instruction set of the kernels in use
+static nnue_kernels kernels = kernels_for(best_instruction_set);                      // Kernels in use
+
+/**
+ * @brief The function reads an array of little endian values from a network file
+ *
+ * @param file is the network file
+ * @param values is the array, resized to the number of values to read
+ * @param count is the number of values to read
+ *
+ * @return true if all the values were read and false otherwise
+ */
+template <typename value_type>
+static bool read_values(ifstream &file, vector<value_type> &values, size_t count)
+{
+    // The values are read as they are stored, which is the byte order of x86-64
+    values.resize(count);
+    file.read((char *)values.data(), count * sizeof(value_type));
+
+    return (bool)file;
+}
+
+bool load_nnue_network(const string &path)
+{
+    ifstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        SDL_Log("Failed to open the network file %s", path.c_str());
+        return false;
+    }
+
+    // The header tells if the network has the shape this program was built for
+    vector<uint32_t> header;
+    const vector<uint32_t> expected_header = {NNUE_FILE_MAGIC, NNUE_FILE_VERSION, NNUE_INPUT_SIZE, NNUE_HIDDEN_SIZE, NNUE_LAYER_SIZE};
+
+    if (!read_values(file, header, expected_header.size()) || header != expected_header)
+    {
+        SDL_Log("The network file %s is not a network of the expected format", path.c_str());
+        return false;
+    }
+
+    nnue_network loaded_network;
+    vector<int32_t> output_bias;
+
+    bool complete = read_values(file, loaded_network.input_biases, NNUE_HIDDEN_SIZE) &&
+                    read_values(file, loaded_network.input_weights, (size_t)NNUE_INPUT_SIZE * NNUE_HIDDEN_SIZE) &&
+                    read_values(file, loaded_network.hidden1_biases, NNUE_LAYER_SIZE) &&
+                    read_values(file, loaded_network.hidden1_weights, NNUE_LAYER_SIZE * 2 * NNUE_HIDDEN_SIZE) &&
+                    read_values(file, loaded_network.hidden2_biases, NNUE_LAYER_SIZE) &&
+                    read_values(file, loaded_network.hidden2_weights, NNUE_LAYER_SIZE * NNUE_LAYER_SIZE) &&
+                    read_values(file, output_bias, 1) &&
+                    read_values(file, loaded_network.output_weights, NNUE_LAYER_SIZE);
+
+    if (!complete)
+    {
+        SDL_Log("The network file %s is truncated", path.c_str());
+        return false;
+    }
+
+    loaded_network.output_bias = output_bias[0];
+    network = std::move(loaded_network);
+    network_loaded = true;
+
+    return true;
+}
+
+bool nnue_network_loaded()
+{
+    return network_loaded;
+}
+
+bool set_evaluator(evaluator_type evaluator)
+{
+    if (evaluator == NNUE_EVALUATOR && !network_loaded)
+    {
+        return false;
+    }
+
+    current_evaluator = evaluator;
+
+    return true;
+}
+
+evaluator_type get_evaluator()
+{
+    return current_evaluator;
+}
+
+nnue_instruction_set get_nnue_instruction_set()
+{
+    return current_instruction_set;
+}
+
+bool set_nnue_instruction_set(nnue_instruction_set instruction_set)
+{
+    if (instruction_set > best_instruction_set)
+    {
+        return false;
+    }
+
+    current_instruction_set = instruction_set;
+    kernels = kernels_for(instruction_set);
+
+    return true;
+}
+
+int nnue_input_index(piece_color perspective, int king_tile, const chess_piece &piece, int tile)
+{
+    // Black's ranks are flipped. Flipping the 3 rank bits of a tile flips its rank
+    if (perspective == BLACK)
+    {
+        king_tile ^= BOARD_SIZE * (BOARD_SIZE - 1);
+        tile ^= BOARD_SIZE * (BOARD_SIZE - 1);
+    }
+
+    // The pieces of the perspective come before the enemy pieces of the same type
+    int piece_kind = 2 * piece.type + (piece.color == perspective ? 0 : 1);
+
+    return (king_tile * NNUE_PIECE_KINDS + piece_kind) * BOARD_SIZE * BOARD_SIZE + tile;
+}
+
+void nnue_reset_accumulator(int16_t *values)
+{
+    std::copy(network.input_biases.begin(), network.input_biases.end(), values);
+}
+
+void nnue_add_input(int16_t *values, int input)
+{
+    kernels.add(values, &network.input_weights[(size_t)input * NNUE_HIDDEN_SIZE]);
+}
+
+void nnue_remove_input(int16_t *values, int input)
+{
+    kernels.subtract(values, &network.input_weights[(size_t)input * NNUE_HIDDEN_SIZE]);
+}
+
+/**
+ * @brief The procedure computes a small hidden layer of the neural network, clipping its neurons between 0 and
+ * NNUE_ACTIVATION_MAX
+ *
+ * @param input is the activations of the previous layer
+ * @param input_size is the number of activations of the previous layer
+ * @param biases is the NNUE_LAYER_SIZE biases of the layer
+ * @param weights is the input_size weights of each neuron of the layer
+ * @param output is the NNUE_LAYER_SIZE activations of the layer
+ */
+static void hidden_layer(const uint8_t *input, int input_size, const int32_t *biases, const int8_t *weights, uint8_t *output)
+{
+    for (int neuron = 0; neuron < NNUE_LAYER_SIZE; neuron++)
+    {
+        int32_t sum = biases[neuron] + kernels.dot_product(input, weights + neuron * input_size, input_size);
+        output[neuron] = (uint8_t)clamp(sum >> NNUE_WEIGHT_SCALE_BITS, 0, NNUE_ACTIVATION_MAX);
+    }
+}
+
+int nnue_evaluation(board &the_board, piece_color player_color)
+{
+    const nnue_accumulator &accumulator = the_board.get_accumulator();
+    piece_color opponent_color = (player_color == WHITE) ? BLACK : WHITE;
+
+    alignas(32) uint8_t input_layer[2 * NNUE_HIDDEN_SIZE];
+    alignas(32) uint8_t hidden1_layer[NNUE_LAYER_SIZE];
+    alignas(32) uint8_t hidden2_layer[NNUE_LAYER_SIZE];
+
+    // The perspective of the player to move comes first, so the network knows whose turn it is
+    kernels.activate(accumulator.values[player_color], input_layer);
+    kernels.activate(accumulator.values[opponent_color], input_layer + NNUE_HIDDEN_SIZE);
+
+    hidden_layer(input_layer, 2 * NNUE_HIDDEN_SIZE, network.hidden1_biases.data(), network.hidden1_weights.data(), hidden1_layer);
+    hidden_layer(hidden1_layer, NNUE_LAYER_SIZE, network.hidden2_biases.data(), network.hidden2_weights.data(), hidden2_layer);
+
+    int32_t output = network.output_bias + kernels.dot_product(hidden2_layer, network.output_weights.data(), NNUE_LAYER_SIZE);
+    int score = output / NNUE_OUTPUT_SCALE;
+
+    return (player_color == WHITE) ? score : -score;
+}
@@ -227,11 +227,12 @@ void AI_move(const SDLStructures &app_structure, game &current_game)
 }
 
 /**
- * @brief This function is called to check if there is a checkmate or stalemate on the board
+ * @brief This function is called to check if there is a checkmate, stalemate, threefold repetition, a draw by
+ * the fifty-move rule or a draw by insufficient material on the board
  * 
  * @param current_game is the current chess game object
  * 
- * @return true if there is a checkmate or stalemate. Returns false otherwise.
+ * @return true if the game is over. Returns false otherwise.
  */
 bool end_the_game(game &current_game)
 {
@@ -257,6 +258,27 @@ bool end_the_game(game &current_game)
         SDL_Log("Draw");
         return true;
     }
+    else if (current_game.game_board.repetition_count() >= 2)
+    {
+        current_game.outcome = DRAW;
+
+        SDL_Log("Draw by threefold repetition");
+        return true;
+    }
+    else if (current_game.game_board.get_halfmove_clock() >= FIFTY_MOVE_RULE_PLIES)
+    {
+        current_game.outcome = DRAW;
+
+        SDL_Log("Draw by the fifty-move rule");
+        return true;
+    }
+    else if (insufficient_material(current_game.game_board))
+    {
+        current_game.outcome = DRAW;
+
+        SDL_Log("Draw by insufficient material");
+        return true;
+    }
 
     return false;
 }
@@ -388,6 +410,45 @@ int main(int argc, char *argv[])
 
     piece_color AI_color = BLACK; // Color of chess pieces played by AI
 
+    // Evaluation parameters written by the tuner are loaded with --parameters <file>. The board was set up with the
+    // default parameters, so it is set up again
+    for (int argument = 1; argument + 1 < argc; argument++)
+    {
+        if (string(argv[argument]) == "--parameters" && load_evaluation_parameters(argv[argument + 1]))
+        {
+            current_game.game_board = board();
+            SDL_Log("Evaluating with the parameters of %s", argv[argument + 1]);
+        }
+    }
+
+    // The AI evaluates with the neural network if a network file is given with --nnue <file>
+    for (int argument = 1; argument + 1 < argc; argument++)
+    {
+        if (string(argv[argument]) == "--nnue" && load_nnue_network(argv[argument + 1]))
+        {
+            set_evaluator(NNUE_EVALUATOR);
+            SDL_Log("Evaluating with the neural network %s", argv[argument + 1]);
+        }
+    }
+
+    // With --trace, the terms of each evaluated position and the cost of each evaluation step are logged
+    for (int argument = 1; argument < argc; argument++)
+    {
+        if (string(argv[argument]) == "--trace")
+        {
+            set_evaluation_tracing(true);
+        }
+    }
+
+    // With --evaluate <file>, the positions of the file are evaluated and the game is not started
+    for (int argument = 1; argument + 1 < argc; argument++)
+    {
+        if (string(argv[argument]) == "--evaluate")
+        {
+            return batch_evaluate(argv[argument + 1]) ? 0 : 1;
+        }
+    }
+
     // Initialising SDL3
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
@@ -426,6 +487,17 @@ int main(int argc, char *argv[])
                 running = false;
             }
 
+            // Pressing E switches between the classic evaluator and the neural network, if one was loaded
+            if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_E)
+            {
+                evaluator_type evaluator = (get_evaluator() == CLASSIC_EVALUATOR) ? NNUE_EVALUATOR : CLASSIC_EVALUATOR;
+
+                if (set_evaluator(evaluator))
+                {
+                    SDL_Log("Evaluating with the %s evaluator", (evaluator == NNUE_EVALUATOR) ? "neural network" : "classic");
+                }
+            }
+
             // If AI is playing, AI will move a piece after the player has played his move
             if (AI_active && current_game.active_player == AI_color)
             {
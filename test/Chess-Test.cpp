@@ -30,4 +30,243 @@ TEST_CASE("Unmove a piece - Unmoving a pawn movement")
     board new_board = the_board.unmove_piece();
 
     REQUIRE(the_board == new_board);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Repetition - Moving the knights out and back repeats the starting position")
+{
+    board the_board;
+
+    move white_knight_out = {{7, 6}, {5, 5}};
+    move black_knight_out = {{0, 6}, {2, 5}};
+    move white_knight_back = {{5, 5}, {7, 6}};
+    move black_knight_back = {{2, 5}, {0, 6}};
+
+    REQUIRE(the_board.repetition_count() == 0);
+
+    for (int cycle = 1; cycle <= 2; cycle++)
+    {
+        the_board.move_piece(white_knight_out);
+        the_board.move_piece(black_knight_out);
+        the_board.move_piece(white_knight_back);
+        the_board.move_piece(black_knight_back);
+
+        REQUIRE(the_board.repetition_count() == cycle);
+        REQUIRE(the_board.get_halfmove_clock() == 4 * cycle);
+    }
+
+    // A pawn move can never be undone, so the earlier positions cannot come back
+    the_board.move_piece({{6, 4}, {4, 4}});
+
+    REQUIRE(the_board.get_halfmove_clock() == 0);
+    REQUIRE(the_board.repetition_count() == 0);
+}
+
+TEST_CASE("Insufficient material - Minor pieces which cannot checkmate")
+{
+    board the_board;
+
+    // Removing every piece except the kings, the g1 knight and the c8 bishop
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            piece_type type = the_board.get_piece_at(rank, file).type;
+
+            if (type != KING && !(rank == 7 && file == 6) && !(rank == 0 && file == 2))
+            {
+                the_board.set_piece_at({rank, file}, {NONE, WHITE});
+            }
+        }
+    }
+
+    REQUIRE(the_board.get_piece_count(WHITE, KNIGHT) == 1);
+    REQUIRE(the_board.get_piece_count(BLACK, BISHOP) == 1);
+    REQUIRE_FALSE(insufficient_material(the_board));
+
+    // King and bishop against king
+    the_board.set_piece_at({7, 6}, {NONE, WHITE});
+    REQUIRE(insufficient_material(the_board));
+
+    // Bishops on squares of the same color
+    the_board.set_piece_at({7, 5}, {BISHOP, WHITE});
+    REQUIRE(insufficient_material(the_board));
+
+    // A pawn can still promote
+    the_board.set_piece_at({6, 0}, {PAWN, WHITE});
+    REQUIRE_FALSE(insufficient_material(the_board));
+}
+
+TEST_CASE("Pawn structure - A passed pawn stops being passed when an enemy pawn can stop it")
+{
+    board the_board;
+
+    // Keeping only the kings
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            if (the_board.get_piece_at(rank, file).type != KING)
+            {
+                the_board.set_piece_at({rank, file}, {NONE, WHITE});
+            }
+        }
+    }
+
+    // An isolated white pawn on a5, which advanced 4 ranks
+    the_board.set_piece_at({3, 0}, {PAWN, WHITE});
+
+    uint64_t white_pawns = the_board.get_piece_bitboard(WHITE, PAWN);
+    int passed_score = make_score(PASSED_PAWN_BONUS_MIDDLEGAME[4] - ISOLATED_PAWN_PENALTY, PASSED_PAWN_BONUS_ENDGAME[4] - ISOLATED_PAWN_PENALTY);
+
+    REQUIRE(pawn_structure_score(white_pawns, 0, WHITE) == passed_score);
+
+    // A black pawn on b7 can capture the pawn when it advances
+    the_board.set_piece_at({1, 1}, {PAWN, BLACK});
+    uint64_t black_pawns = the_board.get_piece_bitboard(BLACK, PAWN);
+
+    REQUIRE(pawn_structure_score(white_pawns, black_pawns, WHITE) == make_score(-ISOLATED_PAWN_PENALTY, -ISOLATED_PAWN_PENALTY));
+}
+
+TEST_CASE("Known endgames - The lone king is worse off at the edge of the board")
+{
+    board the_board;
+
+    // Keeping only the kings and the white queen
+    for (int rank = 0; rank < BOARD_SIZE; rank++)
+    {
+        for (int file = 0; file < BOARD_SIZE; file++)
+        {
+            chess_piece piece = the_board.get_piece_at(rank, file);
+
+            if (piece.type != KING && !(piece.type == QUEEN && piece.color == WHITE))
+            {
+                the_board.set_piece_at({rank, file}, {NONE, WHITE});
+            }
+        }
+    }
+
+    REQUIRE(probe_material_hash(the_board).endgame == KXK_ENDGAME);
+    REQUIRE(probe_material_hash(the_board).strong_side == WHITE);
+
+    int edge_score = kxk_evaluation(the_board, WHITE);
+
+    // Moving the black king from e8 to e5
+    the_board.set_piece_at({0, 4}, {NONE, WHITE});
+    the_board.set_piece_at({3, 4}, {KING, BLACK});
+
+    REQUIRE(kxk_evaluation(the_board, WHITE) < edge_score);
+}
+
+TEST_CASE("Neural network - Both perspectives see mirrored positions the same way")
+{
+    // White king on e1 and white pawn on e2, seen by white
+    int white_input = nnue_input_index(WHITE, 7 * BOARD_SIZE + 4, {PAWN, WHITE}, 6 * BOARD_SIZE + 4);
+
+    // Black king on e8 and black pawn on e7, seen by black
+    int black_input = nnue_input_index(BLACK, 4, {PAWN, BLACK}, BOARD_SIZE + 4);
+
+    REQUIRE(white_input == black_input);
+
+    // The same pawn is an enemy piece for the other perspective
+    REQUIRE(nnue_input_index(BLACK, 4, {PAWN, WHITE}, 6 * BOARD_SIZE + 4) != white_input);
+    REQUIRE(white_input < NNUE_INPUT_SIZE);
+}
+
+TEST_CASE("Load FEN - The incremental state of a loaded position matches a full rescan")
+{
+    board the_board;
+    board starting_board;
+
+    REQUIRE(the_board.load_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    REQUIRE(the_board.get_position_key() == starting_board.get_position_key());
+
+    REQUIRE(the_board.load_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+    REQUIRE(the_board.verify_incremental_state());
+
+    // Every kernel gives the same piece square score
+    uint8_t piece_codes[BOARD_SIZE * BOARD_SIZE];
+    the_board.get_piece_codes(piece_codes);
+
+    REQUIRE(set_piece_square_kernel(SCALAR_PIECE_SQUARE_KERNEL));
+    REQUIRE(piece_square_rescan(piece_codes) == the_board.get_piece_square_score());
+
+    if (set_piece_square_kernel(AVX2_PIECE_SQUARE_KERNEL))
+    {
+        REQUIRE(piece_square_rescan(piece_codes) == the_board.get_piece_square_score());
+    }
+
+    // A position without kings, a negative halfmove clock or an en passant target on the wrong rank is not valid
+    // and leaves the board unchanged
+    REQUIRE_FALSE(the_board.load_fen("8/8/8/8/8/8/8/8 w - -"));
+    REQUIRE_FALSE(the_board.load_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - -5 1"));
+    REQUIRE_FALSE(the_board.load_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3 0 1"));
+    REQUIRE(the_board.verify_incremental_state());
+}
+
+TEST_CASE("Evaluation parameters - Saved parameters are loaded back unchanged")
+{
+    evaluation_parameters default_parameters = get_evaluation_parameters();
+    evaluation_parameters tuned_parameters = default_parameters;
+
+    tuned_parameters.scalars[DOUBLE_PAWN_PENALTY_PARAMETER] = 40;
+    tuned_parameters.piece_tables[KNIGHT][ENDGAME_STAGE][27] = -7;
+
+    REQUIRE(save_evaluation_parameters("evaluation-parameters-test.txt", tuned_parameters));
+    REQUIRE(load_evaluation_parameters("evaluation-parameters-test.txt"));
+
+    REQUIRE(get_evaluation_parameters().scalars[DOUBLE_PAWN_PENALTY_PARAMETER] == 40);
+    REQUIRE(get_evaluation_parameters().piece_tables[KNIGHT][ENDGAME_STAGE][27] == -7);
+    REQUIRE(get_evaluation_parameters().scalars[MOBILITY_WEIGHT_PARAMETER] == MOBILITY_EVALUATION_WEIGHT_PERCENTAGE);
+
+    // Boards set up with the loaded parameters keep a matching piece square score
+    board the_board;
+    REQUIRE(the_board.verify_incremental_state());
+
+    set_evaluation_parameters(default_parameters);
+    std::remove("evaluation-parameters-test.txt");
+}
+
+TEST_CASE("Evaluation features - The fast feature set only evaluates the piece square score")
+{
+    board the_board;
+    REQUIRE(the_board.load_fen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq -"));
+
+    int fast_evaluation = evaluate_board_terms<FAST_EVALUATION_FEATURES>(the_board, 0, WHITE, false, -CHECKMATE_SCORE, CHECKMATE_SCORE);
+    int full_evaluation = evaluate_board_terms<FULL_EVALUATION_FEATURES>(the_board, 0, WHITE, false, -CHECKMATE_SCORE, CHECKMATE_SCORE);
+
+    REQUIRE(fast_evaluation == piece_square_evaluation(the_board));
+
+    // The engine evaluates the feature set it is built with
+    int engine_evaluation = (ENGINE_EVALUATION_FEATURES == FAST_EVALUATION_FEATURES) ? fast_evaluation : full_evaluation;
+    REQUIRE(evaluate_board(the_board, 0, WHITE, false, -CHECKMATE_SCORE, CHECKMATE_SCORE) == engine_evaluation);
+}
+
+TEST_CASE("Evaluation trace - The terms of both players add up to the evaluation")
+{
+    board the_board;
+    REQUIRE(the_board.load_fen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq -"));
+
+    evaluation_trace trace = trace_evaluation(the_board);
+    int sum = 0;
+
+    for (int term = 0; term < EVALUATION_TERM_COUNT; term++)
+    {
+        sum += trace.values[term][WHITE] - trace.values[term][BLACK];
+    }
+
+    // Both players have all their pieces, and each weighted term is rounded on its own
+    REQUIRE(trace.values[MATERIAL_TERM][WHITE] == trace.values[MATERIAL_TERM][BLACK]);
+    REQUIRE(trace.endgame == GENERIC_ENDGAME);
+    REQUIRE(abs(sum - trace.evaluation) <= EVALUATION_TERM_COUNT);
+}
+
+TEST_CASE("King safety - A king next to the enemy king zone is not counted as an attacker")
+{
+    board the_board;
+    REQUIRE(the_board.load_fen("8/5ppp/6k1/8/6K1/8/4Q3/8 w - - 0 1"));
+
+    // Only the queen attacks the zone around the black king, so the attack is not scored as a multiple one
+    attack_info attacks = compute_attack_info(the_board);
+
+    REQUIRE(attacks.king_attackers_count[WHITE] == 1);
+}
@@ -0,0 +1,660 @@
+#include "Chess-Model.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector, std::thread, std::ifstream, std::function, std::max, std::mutex, std::condition_variable, std::unique_lock,
+    std::lock_guard;
+
+const int TUNER_EPOCHS = 8;                          // Default number of times the evaluation is traced around the tuned parameters
+const int TUNER_ITERATIONS = 300;                    // Gradient descent steps on each traced evaluation
+const double TUNER_LEARNING_RATE = 0.05;              // Size of the gradient descent steps, in parameter units
+const double TUNER_FIRST_MOMENT_DECAY = 0.9;         // Decay of the running average of the gradient (Adam)
+const double TUNER_SECOND_MOMENT_DECAY = 0.999;      // Decay of the running average of the squared gradient (Adam)
+const double TUNER_EPSILON = 1e-8;                   // Keeps the steps finite when the gradient of a parameter is always 0
+const int TUNER_FINITE_DIFFERENCE_STEP = 2;          // Step used to measure how the evaluation changes with a scalar parameter
+const int TUNER_SCALING_SEARCH_STEPS = 40;           // Steps of the search of the scaling constant of the sigmoid
+constexpr int PIECE_TABLE_PARAMETER_COUNT = TYPE_OF_PIECE_COUNT * GAME_STAGE_COUNT * BOARD_SIZE * BOARD_SIZE;
+constexpr int TUNED_PARAMETER_COUNT = SCALAR_PARAMETER_COUNT + PIECE_TABLE_PARAMETER_COUNT; // Scalars come first, then the piece tables
+
+/**
+ * @brief struct holding a position and the result of the game it was taken from
+ */
+struct labelled_position
+{
+    string fen;    // The position in Forsyth-Edwards Notation
+    double result; // 1 if white won the game, 0.5 if it was drawn and 0 if black won
+};
+
+/**
+ * @brief struct holding the coefficient of one piece table entry in the evaluation of a position
+ */
+struct piece_table_term
+{
+    uint16_t parameter; // Index of the piece table entry among the tuned parameters
+    float coefficient;  // Change of the evaluation when the entry grows by 1
+};
+
+/**
+ * @brief struct holding the evaluation of a position as a linear function of the tuned parameters, traced around
+ * the parameters of the current epoch. Gradient descent works on the traces instead of evaluating the positions
+ * again, which makes each step cost a few multiplications per position.
+ */
+struct position_trace
+{
+    float evaluation;                                  // Evaluation with the traced parameters, from white's point of view
+    float result;                                      // Result of the game, see labelled_position
+    float scalar_coefficients[SCALAR_PARAMETER_COUNT]; // Change of the evaluation when each scalar parameter grows by 1
+    uint32_t first_term;                               // Index of the first piece table term of the position in its shard
+    uint32_t term_count;                               // Number of piece table terms of the position
+};
+
+/**
+ * @brief struct holding the part of the positions tuned by one thread, so that threads never share data
+ */
+struct tuning_shard
+{
+    vector<labelled_position> positions; // Positions of the shard
+    vector<position_trace> traces;       // Trace of each position
+    vector<piece_table_term> terms;      // Piece table terms of all the traces
+    vector<float> evaluations;           // Evaluation of each position with the parameters in use
+    vector<double> gradient;             // Gradient of the error on the positions of the shard
+    double error = 0;                    // Sum of the squared errors on the positions of the shard
+};
+
+/**
+ * @brief class holding one worker thread per shard, started once and kept for the whole tuning. Each job is run by
+ * every worker on its own shard. The evaluation caches belong to the workers and outlive the jobs, so a job which
+ * evaluates positions after the parameters changed must call clear_evaluation_caches first.
+ */
+class worker_pool
+{
+private:
+    vector<tuning_shard> &shards;                        // Shards of the workers, one per worker
+    vector<thread> workers;                              // The worker threads
+    mutex job_mutex;                                     // Guards every member below
+    condition_variable job_ready;                        // Signalled when a job is given or the workers must stop
+    condition_variable job_done;                         // Signalled when the last worker finishes the job
+    const function<void(tuning_shard &)> *job = nullptr; // Job in progress
+    uint64_t job_number = 0;                             // Number of jobs given, so that workers see new ones
+    size_t running_workers = 0;                          // Workers which did not finish the job in progress
+    bool stopping = false;                               // True when the workers must stop
+
+    /**
+     * @brief The procedure is run by each worker. It waits for a job, runs it on the shard of the worker and tells the
+     * pool when it is done, until the pool stops.
+     *
+     * @param worker is the index of the worker, which is the index of its shard
+     */
+    void work(size_t worker)
+    {
+        uint64_t last_job_number = 0;
+
+        while (true)
+        {
+            const function<void(tuning_shard &)> *current_job;
+
+            {
+                unique_lock<mutex> lock(this->job_mutex);
+                this->job_ready.wait(lock, [this, last_job_number]
+                                     { return this->stopping || this->job_number != last_job_number; });
+
+                if (this->stopping)
+                {
+                    return;
+                }
+
+                last_job_number = this->job_number;
+                current_job = this->job;
+            }
+
+            (*current_job)(this->shards[worker]);
+
+            lock_guard<mutex> lock(this->job_mutex);
+
+            if (--this->running_workers == 0)
+            {
+                this->job_done.notify_one();
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Constructor starting one worker for each shard
+     *
+     * @param shards is the shards. They must outlive the pool
+     */
+    worker_pool(vector<tuning_shard> &shards) : shards(shards)
+    {
+        for (size_t worker = 0; worker < shards.size(); worker++)
+        {
+            this->workers.emplace_back(&worker_pool::work, this, worker);
+        }
+    }
+
+    /**
+     * @brief Destructor stopping the workers once they are idle
+     */
+    ~worker_pool()
+    {
+        {
+            lock_guard<mutex> lock(this->job_mutex);
+            this->stopping = true;
+        }
+
+        this->job_ready.notify_all();
+
+        for (thread &worker : this->workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief The procedure runs a job on every shard, each shard in its own worker, and waits for all of them
+     *
+     * @param new_job is the job to run on each shard
+     */
+    void run(const function<void(tuning_shard &)> &new_job)
+    {
+        unique_lock<mutex> lock(this->job_mutex);
+
+        this->job = &new_job;
+        this->running_workers = this->workers.size();
+        this->job_number++;
+        this->job_ready.notify_all();
+
+        this->job_done.wait(lock, [this]
+                            { return this->running_workers == 0; });
+    }
+};
+
+/**
+ * @brief The function evaluates a position with every evaluation term, from white's point of view
+ *
+ * @param the_board is the position
+ *
+ * @return the evaluation
+ */
+static int full_evaluation(board &the_board)
+{
+    piece_color player_color = the_board.get_side_to_move();
+
+    return evaluate_board_terms<FULL_EVALUATION_FEATURES>(the_board, 0, player_color, false, -CHECKMATE_SCORE, CHECKMATE_SCORE);
+}
+
+/**
+ * @brief The function finds the result of the game in a line of a position file. Results are written as 1-0, 0-1
+ * or 1/2-1/2 anywhere after the position, as in the EPD files commonly used for tuning.
+ *
+ * @param line is the line
+ * @param result is the result found, see labelled_position
+ *
+ * @return true if a result was found and false otherwise
+ */
+static bool parse_result(const string &line, double &result)
+{
+    if (line.find("1/2-1/2") != string::npos)
+    {
+        result = 0.5;
+    }
+    else if (line.find("1-0") != string::npos)
+    {
+        result = 1.0;
+    }
+    else if (line.find("0-1") != string::npos)
+    {
+        result = 0.0;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief The function loads the labelled positions of a file and spreads them over the shards. Positions in check,
+ * without legal moves or with an evaluation of their own (see endgame_type) are left out, as the evaluation terms
+ * do not decide their score.
+ *
+ * @param path is the path of the position file
+ * @param shards is the shards
+ *
+ * @return the number of positions loaded
+ */
+static size_t load_positions(const string &path, vector<tuning_shard> &shards)
+{
+    ifstream file(path);
+    board the_board;
+    string line;
+    size_t loaded_positions = 0;
+
+    while (getline(file, line))
+    {
+        labelled_position position;
+
+        if (!parse_result(line, position.result) || !the_board.load_fen(line))
+        {
+            continue;
+        }
+
+        piece_color player_color = the_board.get_side_to_move();
+
+        if (the_board.king_in_check(player_color) || !has_legal_move(the_board, player_color) ||
+            probe_material_hash(the_board).endgame != GENERIC_ENDGAME)
+        {
+            continue;
+        }
+
+        position.fen = line;
+        shards[loaded_positions % shards.size()].positions.push_back(position);
+        loaded_positions++;
+    }
+
+    return loaded_positions;
+}
+
+/**
+ * @brief The function returns the expected result of a game from an evaluation
+ *
+ * @param evaluation is the evaluation, from white's point of view
+ * @param scaling is the scaling constant of the sigmoid
+ *
+ * @return the expected result, between 0 and 1
+ */
+static double expected_result(double evaluation, double scaling)
+{
+    return 1.0 / (1.0 + pow(10.0, -scaling * evaluation / 400.0));
+}
+
+/**
+ * @brief The function converts the tuned parameters to evaluation parameters, rounding them to integers
+ *
+ * @param values is the tuned parameters, see TUNED_PARAMETER_COUNT
+ *
+ * @return the evaluation parameters
+ */
+static evaluation_parameters to_evaluation_parameters(const vector<double> &values)
+{
+    evaluation_parameters parameters = {};
+
+    for (int parameter = 0; parameter < SCALAR_PARAMETER_COUNT; parameter++)
+    {
+        parameters.scalars[parameter] = (int)lround(values[parameter]);
+    }
+
+    int *piece_tables = &parameters.piece_tables[0][0][0];
+
+    for (int parameter = 0; parameter < PIECE_TABLE_PARAMETER_COUNT; parameter++)
+    {
+        piece_tables[parameter] = (int)lround(values[SCALAR_PARAMETER_COUNT + parameter]);
+    }
+
+    return parameters;
+}
+
+/**
+ * @brief The function checks if a tuned parameter is changed by the tuner. The positional weight multiplies every
+ * piece table entry, so tuning it along with the piece tables would only rescale them.
+ *
+ * @param parameter is the index of the tuned parameter
+ *
+ * @return true if the parameter is changed by the tuner and false otherwise
+ */
+static bool is_tuned(int parameter)
+{
+    return parameter != POSITIONAL_WEIGHT_PARAMETER;
+}
+
+/**
+ * @brief The procedure evaluates every position of the shards with the parameters in use
+ *
+ * @param pool is the workers, whose shards get their evaluations written
+ */
+static void evaluate_positions(worker_pool &pool)
+{
+    pool.run([](tuning_shard &shard)
+             {
+                 // The caches of the worker hold evaluations made with the parameters of an earlier job
+                 clear_evaluation_caches();
+
+                 board the_board;
+                 shard.evaluations.resize(shard.positions.size());
+
+                 for (size_t index = 0; index < shard.positions.size(); index++)
+                 {
+                     the_board.load_fen(shard.positions[index].fen);
+                     shard.evaluations[index] = (float)full_evaluation(the_board);
+                 } });
+}
+
+/**
+ * @brief The function returns the mean squared error between the results of the games and the expected results of
+ * the evaluations
+ *
+ * @param shards is the shards, whose evaluations are used
+ * @param scaling is the scaling constant of the sigmoid
+ *
+ * @return the mean squared error
+ */
+static double evaluation_error(vector<tuning_shard> &shards, double scaling)
+{
+    double error = 0;
+    size_t positions = 0;
+
+    for (const tuning_shard &shard : shards)
+    {
+        for (size_t index = 0; index < shard.positions.size(); index++)
+        {
+            double difference = shard.positions[index].result - expected_result(shard.evaluations[index], scaling);
+            error += difference * difference;
+        }
+
+        positions += shard.positions.size();
+    }
+
+    return error / max(positions, (size_t)1);
+}
+
+/**
+ * @brief The function finds the scaling constant of the sigmoid which best maps the evaluations with the parameters
+ * in use to the results of the games. The error is convex in the scaling constant, so a ternary search finds it.
+ *
+ * @param shards is the shards, whose evaluations are used
+ *
+ * @return the scaling constant
+ */
+static double find_scaling_constant(vector<tuning_shard> &shards)
+{
+    double low = 0.0;
+    double high = 4.0;
+
+    for (int step = 0; step < TUNER_SCALING_SEARCH_STEPS; step++)
+    {
+        double first_third = low + (high - low) / 3;
+        double second_third = high - (high - low) / 3;
+
+        if (evaluation_error(shards, first_third) < evaluation_error(shards, second_third))
+        {
+            high = second_third;
+        }
+        else
+        {
+            low = first_third;
+        }
+    }
+
+    return (low + high) / 2;
+}
+
+/**
+ * @brief The procedure traces the evaluation of every position around the tuned parameters. Piece table entries
+ * are added to the evaluation through the piece square score, so their coefficients are found from the pieces on
+ * the board. The scalar parameters are not linear in the evaluation, so their coefficients are measured by
+ * evaluating every position again with each of them a little higher and a little lower.
+ *
+ * @param pool is the workers
+ * @param shards is the shards of the workers, whose traces are written
+ * @param values is the tuned parameters
+ */
+static void trace_positions(worker_pool &pool, vector<tuning_shard> &shards, const vector<double> &values)
+{
+    evaluation_parameters parameters = to_evaluation_parameters(values);
+    set_evaluation_parameters(parameters);
+
+    double positional_weight = (double)parameters.scalars[POSITIONAL_WEIGHT_PARAMETER] / (int)EVALUATION_WEIGHT_SCALE;
+
+    pool.run([positional_weight](tuning_shard &shard)
+             {
+                 // The caches of the worker hold evaluations made with the parameters of an earlier job
+                 clear_evaluation_caches();
+
+                 board the_board;
+                 shard.traces.assign(shard.positions.size(), {});
+                 shard.terms.clear();
+
+                 for (size_t index = 0; index < shard.positions.size(); index++)
+                 {
+                     position_trace &trace = shard.traces[index];
+                     the_board.load_fen(shard.positions[index].fen);
+
+                     trace.evaluation = (float)full_evaluation(the_board);
+                     trace.result = (float)shard.positions[index].result;
+                     trace.first_term = (uint32_t)shard.terms.size();
+
+                     // The middlegame and endgame tables are blended according to the game phase
+                     int phase = determine_game_phase(the_board);
+                     double stage_weight[GAME_STAGE_COUNT] = {(double)phase / MAX_PHASE_WEIGHT, (double)(MAX_PHASE_WEIGHT - phase) / MAX_PHASE_WEIGHT};
+
+                     for (int tile = 0; tile < BOARD_SIZE * BOARD_SIZE; tile++)
+                     {
+                         chess_piece piece = the_board.get_piece_at(tile / BOARD_SIZE, tile % BOARD_SIZE);
+
+                         if (piece.type == NONE)
+                         {
+                             continue;
+                         }
+
+                         // Tables are written from white's point of view, so black pieces use the flipped tile
+                         int table_tile = (piece.color == WHITE) ? tile : tile ^ (BOARD_SIZE * (BOARD_SIZE - 1));
+                         double sign = (piece.color == WHITE) ? 1.0 : -1.0;
+
+                         for (int stage = MIDDLEGAME_STAGE; stage < GAME_STAGE_COUNT; stage++)
+                         {
+                             int parameter = SCALAR_PARAMETER_COUNT + ((int)piece.type * GAME_STAGE_COUNT + stage) * BOARD_SIZE * BOARD_SIZE + table_tile;
+                             shard.terms.push_back({(uint16_t)parameter, (float)(sign * positional_weight * stage_weight[stage])});
+                         }
+                     }
+
+                     trace.term_count = (uint32_t)shard.terms.size() - trace.first_term;
+                 } });
+
+    // Central differences of each scalar parameter
+    for (int scalar = 0; scalar < SCALAR_PARAMETER_COUNT; scalar++)
+    {
+        vector<vector<float>> evaluations_by_direction;
+
+        for (int direction : {1, -1})
+        {
+            evaluation_parameters moved_parameters = parameters;
+            moved_parameters.scalars[scalar] += direction * TUNER_FINITE_DIFFERENCE_STEP;
+            set_evaluation_parameters(moved_parameters);
+
+            evaluate_positions(pool);
+
+            for (tuning_shard &shard : shards)
+            {
+                evaluations_by_direction.push_back(shard.evaluations);
+            }
+        }
+
+        for (size_t shard = 0; shard < shards.size(); shard++)
+        {
+            const vector<float> &higher = evaluations_by_direction[shard];
+            const vector<float> &lower = evaluations_by_direction[shards.size() + shard];
+
+            for (size_t index = 0; index < shards[shard].traces.size(); index++)
+            {
+                shards[shard].traces[index].scalar_coefficients[scalar] = (higher[index] - lower[index]) / (2 * TUNER_FINITE_DIFFERENCE_STEP);
+            }
+        }
+    }
+
+    set_evaluation_parameters(parameters);
+}
+
+/**
+ * @brief The function computes the mean squared error of the traced evaluations moved by a change of the tuned
+ * parameters, and its gradient with regard to that change
+ *
+ * @param pool is the workers
+ * @param shards is the shards of the workers, whose traces are used
+ * @param change is the change of the tuned parameters since they were traced
+ * @param scaling is the scaling constant of the sigmoid
+ * @param gradient is the gradient, written by the function
+ *
+ * @return the mean squared error
+ */
+static double traced_error(worker_pool &pool, vector<tuning_shard> &shards, const vector<double> &change, double scaling, vector<double> &gradient)
+{
+    pool.run([&change, scaling](tuning_shard &shard)
+             {
+                 shard.gradient.assign(TUNED_PARAMETER_COUNT, 0.0);
+                 shard.error = 0;
+
+                 for (const position_trace &trace : shard.traces)
+                 {
+                     double evaluation = trace.evaluation;
+
+                     for (int scalar = 0; scalar < SCALAR_PARAMETER_COUNT; scalar++)
+                     {
+                         evaluation += trace.scalar_coefficients[scalar] * change[scalar];
+                     }
+
+                     for (uint32_t term = trace.first_term; term < trace.first_term + trace.term_count; term++)
+                     {
+                         evaluation += shard.terms[term].coefficient * change[shard.terms[term].parameter];
+                     }
+
+                     // Derivative of the squared error with regard to the evaluation
+                     double expected = expected_result(evaluation, scaling);
+                     double difference = expected - trace.result;
+                     double slope = 2 * difference * expected * (1 - expected) * scaling * log(10.0) / 400.0;
+
+                     shard.error += difference * difference;
+
+                     for (int scalar = 0; scalar < SCALAR_PARAMETER_COUNT; scalar++)
+                     {
+                         shard.gradient[scalar] += slope * trace.scalar_coefficients[scalar];
+                     }
+
+                     for (uint32_t term = trace.first_term; term < trace.first_term + trace.term_count; term++)
+                     {
+                         shard.gradient[shard.terms[term].parameter] += slope * shard.terms[term].coefficient;
+                     }
+                 } });
+
+    double error = 0;
+    size_t positions = 0;
+    gradient.assign(TUNED_PARAMETER_COUNT, 0.0);
+
+    for (const tuning_shard &shard : shards)
+    {
+        error += shard.error;
+        positions += shard.traces.size();
+
+        for (int parameter = 0; parameter < TUNED_PARAMETER_COUNT; parameter++)
+        {
+            gradient[parameter] += shard.gradient[parameter];
+        }
+    }
+
+    for (double &derivative : gradient)
+    {
+        derivative /= max(positions, (size_t)1);
+    }
+
+    return error / max(positions, (size_t)1);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        SDL_Log("Usage: ChessTuner <position file> <parameter file> [epochs]");
+        return 1;
+    }
+
+    int epochs = (argc > 3) ? atoi(argv[3]) : TUNER_EPOCHS;
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Each thread tunes its own shard of the positions, which are loaded once and kept in memory
+    vector<tuning_shard> shards(max(thread::hardware_concurrency(), 1u));
+    size_t loaded_positions = load_positions(argv[1], shards);
+
+    if (loaded_positions == 0)
+    {
+        SDL_Log("No labelled position found in %s", argv[1]);
+        return 1;
+    }
+
+    SDL_Log("Loaded %zu positions on %zu threads", loaded_positions, shards.size());
+
+    // The workers are started once and kept until the parameters are written
+    worker_pool pool(shards);
+
+    // The tuned parameters start from the parameters in use
+    const evaluation_parameters &initial_parameters = get_evaluation_parameters();
+    vector<double> values(initial_parameters.scalars, initial_parameters.scalars + SCALAR_PARAMETER_COUNT);
+    const int *initial_piece_tables = &initial_parameters.piece_tables[0][0][0];
+    values.insert(values.end(), initial_piece_tables, initial_piece_tables + PIECE_TABLE_PARAMETER_COUNT);
+
+    evaluate_positions(pool);
+    double scaling = find_scaling_constant(shards);
+
+    SDL_Log("Scaling constant %.4f, initial error %.6f", scaling, evaluation_error(shards, scaling));
+
+    for (int epoch = 0; epoch < epochs; epoch++)
+    {
+        trace_positions(pool, shards, values);
+
+        // Adam on the change of the parameters since they were traced
+        vector<double> change(TUNED_PARAMETER_COUNT, 0.0);
+        vector<double> first_moment(TUNED_PARAMETER_COUNT, 0.0);
+        vector<double> second_moment(TUNED_PARAMETER_COUNT, 0.0);
+        vector<double> gradient;
+        double error = 0;
+
+        for (int iteration = 1; iteration <= TUNER_ITERATIONS; iteration++)
+        {
+            error = traced_error(pool, shards, change, scaling, gradient);
+
+            for (int parameter = 0; parameter < TUNED_PARAMETER_COUNT; parameter++)
+            {
+                if (!is_tuned(parameter))
+                {
+                    continue;
+                }
+
+                first_moment[parameter] = TUNER_FIRST_MOMENT_DECAY * first_moment[parameter] + (1 - TUNER_FIRST_MOMENT_DECAY) * gradient[parameter];
+                second_moment[parameter] = TUNER_SECOND_MOMENT_DECAY * second_moment[parameter] + (1 - TUNER_SECOND_MOMENT_DECAY) * gradient[parameter] * gradient[parameter];
+
+                double corrected_first_moment = first_moment[parameter] / (1 - pow(TUNER_FIRST_MOMENT_DECAY, iteration));
+                double corrected_second_moment = second_moment[parameter] / (1 - pow(TUNER_SECOND_MOMENT_DECAY, iteration));
+
+                change[parameter] -= TUNER_LEARNING_RATE * corrected_first_moment / (sqrt(corrected_second_moment) + TUNER_EPSILON);
+            }
+        }
+
+        for (int parameter = 0; parameter < TUNED_PARAMETER_COUNT; parameter++)
+        {
+            values[parameter] += change[parameter];
+        }
+
+        // The traced error is an estimate. The evaluation error tells how much the rounded parameters really improved
+        set_evaluation_parameters(to_evaluation_parameters(values));
+        evaluate_positions(pool);
+
+        SDL_Log("Epoch %d: traced error %.6f, evaluation error %.6f", epoch + 1, error, evaluation_error(shards, scaling));
+    }
+
+    if (!save_evaluation_parameters(argv[2], to_evaluation_parameters(values)))
+    {
+        SDL_Log("Failed to write the parameter file %s", argv[2]);
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    SDL_Log("Tuned parameters written to %s in %.1f s", argv[2], seconds);
+
+    return 0;
+}